@@ -10,235 +10,399 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "aco.h"
 
-int ntry;
-
 
 /*************************    ACO procedures  *****************************/
 
-int termination_condition( void )
+int termination_condition( aco_context *ctx )
 /*    
       FUNCTION:       checks whether termination condition is met 
-      INPUT:          none
-      OUTPUT:         0 if condition is not met, number neq 0 otherwise
+      INPUT:          pointer to the try
+      OUTPUT:         0 if condition is not met, number neq 0 otherwise; with the island
+                      model the try also ends once any island reached the optimal
       (SIDE)EFFECTS:  none
+      COMMENTS:       the clock is only read every DEADLINE_CHECK iterations
 */
 {
-  return ( ((iteration >= max_iters) || (elapsed_time( REAL ) >= max_time)) ||
-	  (best_so_far_ant_score <= optimal));
+  return ( ((ctx->iteration >= ctx->max_iters) ||
+            (ctx->iteration % DEADLINE_CHECK == 0 && elapsed_time( ctx, REAL ) >= ctx->max_time)) ||
+	  (ctx->best_so_far_ant_score <= ctx->optimal) ||
+	  (ctx->migration && atomic_load( &ctx->migration->done )));
 }
 
 
 
-void construct_solutions()
+void construct_solutions( aco_context *ctx )
 /*    
       FUNCTION:       manage the solution construction phase
-      INPUT:          none
+      INPUT:          pointer to the try
       OUTPUT:         none
       (SIDE)EFFECTS:  when finished, all ants of the colony have constructed a solution  
+      COMMENTS:       ants are independent (own solution, score and random stream),
+                      so they are built and evaluated in parallel, each by the
+                      thread that first touched it, see allocate_ants(); random numbers
+                      are drawn in batches of one word of gates and compared with
+                      the choice table, see construct_word(). A decomposable
+                      objective is accumulated while the words are built, and
+                      each thread ranks the ants it built, any other is
+                      evaluated for the whole colony in one batch, through the
+                      score cache when enabled, and ranked afterwards. With
+                      gate_parallel the ants are built one after the other,
+                      each by all threads, see construct_ant_blocks()
 */
 {
-    int k, j;        /* counter variable */
-
-    for ( k = 0 ; k < n_ants ; k++ ) {
-       for ( j = 0 ; j < n ; j++ ) {
-            select_gate( k, j );
+    int k;        /* counter variable */
+    const int n_words = ctx->n_words;
+    const aco_objective *obj = ctx->objective;
+    double score;
+
+    ctx->top.n = 0;
+    if ( ctx->gate_parallel ) {
+        for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+            construct_ant_blocks( ctx, k, 0 );
+            if ( obj->evaluate_word ) top_insert( &ctx->top, ctx->top_k, k, ctx->ant_scores[k] );
         }
-        
-        /* compute scores */
-        ant_scores[k] = obj_function( k );
+    }
+    else
+    #pragma omp parallel private(score)
+    {
+        top_ants local;
+
+        local.n = 0;
+        #pragma omp for schedule(static)
+        for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+            score = construct_ant( ctx, &ctx->ant_rng[k], ctx->choice_threshold,
+                                   ctx->greedy_choice, &ctx->ant_solutions[k * n_words] );
+            ctx->ant_scores[k] = score;
+            if ( obj->evaluate_word ) top_insert( &local, ctx->top_k, k, score );
+        }
+        #pragma omp critical
+        top_merge( &ctx->top, &local, ctx->top_k );
+    }
+
+    PHASE_END( ctx, PH_CONSTRUCT );
+
+    /* compute scores */
+    if ( !obj->evaluate_word ) {
+        evaluate_colony( ctx );
+        rank_colony( ctx );
+        PHASE_END( ctx, PH_EVALUATE );
     }
 }
 
 
-void init_ants()
+void init_ants( aco_context *ctx )
 /*
  FUNCTION:       manage the solution construction phase for the first iteration
- INPUT:          none
+ INPUT:          pointer to the try
  OUTPUT:         none
  (SIDE)EFFECTS:  when finished, all ants of the colony have constructed a solution
  */
 {
-    int k, j, rnd;   
+    int k;   
+    const int n = ctx->n, n_words = ctx->n_words;
+    uint64_t *solution;
     
-    /* solution for ants initialized randomly */
-    for ( k = 0 ; k < n_ants ; k++ ) {
-        for ( j = 0 ; j < n ; j++ ) {
-            rnd = (int) round( ran01( &seed ) ); /* random number 0 or 1 */
-            ant_solutions[k * n + j] = rnd;
-        }
- 
-        /* compute scores */
-        ant_scores[k] = obj_function(k);
+    /* solution for ants initialized randomly, 64 random gates per draw */
+    if ( ctx->gate_parallel )
+        for ( k = 0 ; k < ctx->n_ants ; k++ )
+            construct_ant_blocks( ctx, k, 1 );
+    else
+    #pragma omp parallel for private(solution) schedule(static)
+    for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+        solution = &ctx->ant_solutions[k * n_words];
+        rng_fill_bits( &ctx->ant_rng[k], solution, n_words );
+        if ( n % WORD_BITS )
+            solution[n_words - 1] &= ((uint64_t) 1 << (n % WORD_BITS)) - 1;
     }
+ 
+    PHASE_END( ctx, PH_CONSTRUCT );
+
+    /* compute scores */
+    evaluate_colony( ctx );
+    rank_colony( ctx );
+    PHASE_END( ctx, PH_EVALUATE );
+}
+
+
+void init_context( aco_context *ctx, const aco_params *p, const aco_instance *inst,
+                   aco_reports *reports, aco_arena *arena, int ntry )
+/*
+      FUNCTION: set up the context of a try from the parameters and the instance
+      INPUT:    pointer to the try, parameters, instance, output files, arena
+                of the calling thread and try number
+      OUTPUT:   none
+      COMMENTS: the instance is only referenced, never copied or modified
+*/
+{
+    ctx->n             = inst->n;
+    ctx->n_words       = inst->n_words;
+    ctx->objective     = inst->objective;
+    ctx->obj_state     = inst->obj_state;
+
+    ctx->n_ants        = p->n_ants;
+    ctx->rho           = p->rho;
+    ctx->q_0           = p->q_0;
+    ctx->u_gb          = p->u_gb;
+    ctx->max_iters     = p->max_iters;
+    ctx->restart_iters = p->restart_iters;
+    ctx->max_time      = p->max_time;
+    ctx->optimal       = p->optimal;
+    ctx->seed          = p->seed;
+
+    ctx->reports       = reports;
+    ctx->arena         = arena;
+    ctx->ntry          = ntry;
+
+    ctx->island             = 0;
+    ctx->migration_interval = p->migration_interval;
+    ctx->migration          = NULL;
+
+    ctx->cache_size         = p->cache_size;
+    ctx->cache_verify       = p->cache_verify;
+
+    ctx->checkpoint_interval = p->checkpoint_interval;
+    ctx->resume             = p->resume;
+
+    ctx->elite_ants         = p->elite_ants < 1 ? 1 : p->elite_ants;
+    if ( ctx->elite_ants > MAX_ELITE ) ctx->elite_ants = MAX_ELITE;
+    if ( ctx->elite_ants > ctx->n_ants ) ctx->elite_ants = ctx->n_ants;
+    ctx->rank_deposit       = p->rank_deposit;
+    ctx->ls_ants            = p->ls_ants < 0 ? 0 : p->ls_ants;
+    if ( ctx->ls_ants > MAX_ELITE ) ctx->ls_ants = MAX_ELITE;
+    if ( ctx->ls_ants > ctx->n_ants ) ctx->ls_ants = ctx->n_ants;
+    ctx->top_k              = ctx->ls_ants > ctx->elite_ants ? ctx->ls_ants : ctx->elite_ants;
+
+    ctx->restart_pinned     = p->restart_pinned;
+    ctx->restart_branching  = p->restart_branching;
+    ctx->restart_diversity  = p->restart_diversity;
+    ctx->log_stagnation     = p->log_stagnation;
+    ctx->async_colony       = p->async_colony;
+    ctx->async              = NULL;
+    ctx->gate_parallel      = p->gate_parallel;
 }
 
 
-void init_aco( void )
+void init_aco( aco_context *ctx )
 /*    
       FUNCTION: initilialize variables appropriately when starting a trial
-      INPUT:    none
+      INPUT:    pointer to the try
       OUTPUT:   none
       COMMENTS: none
 */
 {
 
     /* Allocate ants */
-    allocate_ants();
+    allocate_ants( ctx );
 
     /* Initialize variables concerning statistics etc. */
-    iteration    = 1;
-    best_iteration = 1;
-    restart_best = 1;
-    n_restarts = 0;
-    best_so_far_ant_score = INFTY;
+    ctx->iteration      = 1;
+    init_ant_rng( ctx );
+    ctx->best_iteration = 1;
+    ctx->restart_best   = 1;
+    ctx->n_restarts     = 0;
+    ctx->best_so_far_ant_score = INFTY;
+    ctx->migrant_pending = 0;
+    ctx->stopped         = 0;
+    ctx->pinned          = 0.0;
+    ctx->branching       = 2.0;
+    ctx->diversity       = 1.0;
+    memset( ctx->phases, 0, sizeof( ctx->phases ) );
+
+    ctx->checkpoint_buf     = NULL;
+    ctx->checkpoint_started = 0;
+    ctx->checkpoint_seen    = 0;
+    ctx->last_checkpoint    = 0.0;
+    atomic_init( &ctx->checkpoint_busy, 0 );
+    if ( ctx->migration )
+        sprintf(ctx->checkpoint_file, "checkpoint_%d_%d", ctx->ntry, ctx->island);
+    else
+        sprintf(ctx->checkpoint_file, "checkpoint_%d", ctx->ntry);
+    ctx->cache = (ctx->cache_size > 0) ?
+                 init_cache( ctx->cache_size, ctx->n_words, ctx->n_ants, ctx->cache_verify ) : NULL;
     
-    start_timers();
-    best_time = 0.0;
-    time_used = elapsed_time( REAL );
-    time_passed = time_used;
+    start_timers( ctx );
+    ctx->best_time   = 0.0;
+    ctx->time_used   = elapsed_time( ctx, REAL );
+    ctx->time_passed = ctx->time_used;
    
-    /* allocate pheromone matrix */
-    pheromone = generate_double_matrix( n, 2 );
-
     /* Initialize pheromone trails */
-    trail_max = 1. / ( (rho) * 0.5 );
-    trail_min = trail_max / ( 2. * n );
-    trail_0 = trail_max;
-    init_pheromone_trails( trail_0 );
+    ctx->trail_max = 1. / ( (ctx->rho) * 0.5 );
+    ctx->trail_min = ctx->trail_max / ( 2. * ctx->n );
+    ctx->trail_0   = ctx->trail_max;
+    init_pheromone_trails( ctx, ctx->trail_0 );
+    compute_choice_table( ctx );
 
 
-    if (report) fprintf(report,"******** Try: %d **********\n",ntry);
-    if (report_iter) fprintf(report_iter,"******** Try: %d **********\n",ntry);
+    write_report( ctx, REC_TRY );
    
  
 }
 
-void exit_aco( void )
+void exit_aco( aco_context *ctx )
 /*
  FUNCTION: end trial
- INPUT:    none
+ INPUT:    pointer to the try
  OUTPUT:   none
- COMMENTS: none
+ COMMENTS: a try that was stopped, or had finished before a resume, is not
+           reported
  */
 {
 
-    write_report ( );
+    if ( !ctx->stopped ) write_report ( ctx, REC_FINAL );
+    exit_checkpoint( ctx );
 
-    free( pheromone );
-    free( ant_solutions );
-    free( ant_scores );
-    free( best_so_far_ant_solution );
+    /* the colony buffers stay in the arena for the next try */
+    if ( ctx->cache ) exit_cache( ctx->cache );
 }
     
-void update_statistics( void )
+static int stagnated( aco_context *ctx )
+/*    
+      FUNCTION:       check the convergence metrics against the restart thresholds
+      INPUT:          pointer to the try
+      OUTPUT:         1 if any enabled threshold is crossed, at least
+                      STAGNATION_MIN_ITERS iterations after the last restart
+      (SIDE)EFFECTS:  none; pinned and branching are those of the last
+                      pheromone update, diversity that of this colony
+*/
+{
+    if ( ctx->iteration - ctx->restart_best <= STAGNATION_MIN_ITERS )
+        return 0;
+    return ( ctx->restart_pinned > 0.0 && ctx->pinned >= ctx->restart_pinned ) ||
+           ( ctx->restart_branching > 0.0 && ctx->branching <= ctx->restart_branching ) ||
+           ( ctx->restart_diversity > 0.0 && ctx->diversity <= ctx->restart_diversity );
+}
+
+
+void update_statistics( aco_context *ctx )
 /*    
       FUNCTION:       manage some statistical information about the trial, especially
                       if a new best solution (best-so-far or restart-best) is found and
                       adjust some parameters if a new best solution is found
-      INPUT:          none
+      INPUT:          pointer to the try
       OUTPUT:         none
       (SIDE)EFFECTS:  restart-best and best-so-far ant may be updated; trail_min 
-                      and trail_max used by MMAS may be updated
+                      and trail_max used by MMAS may be updated; the trails are
+                      reset after restart_iters iterations without improvement,
+                      or earlier once the colony has stagnated
 */
 {
 
     int iteration_best_ant;
 
-    iteration_best_ant = find_best(); /* iteration_best_ant is a global variable */
+    iteration_best_ant = find_best( ctx );
 
-    if ( ant_scores[iteration_best_ant] < best_so_far_ant_score ) {
-        time_used = elapsed_time( REAL ); /* best sol found after time_used */
-        copy_from_to( &ant_solutions[iteration_best_ant * n], ant_scores[iteration_best_ant],
-        best_so_far_ant_solution, &best_so_far_ant_score );
+    if ( ctx->ant_scores[iteration_best_ant] < ctx->best_so_far_ant_score ) {
+        ctx->time_used = elapsed_time( ctx, REAL ); /* best sol found after time_used */
+        copy_from_to( ctx, &ctx->ant_solutions[iteration_best_ant * ctx->n_words],
+                      ctx->ant_scores[iteration_best_ant],
+                      ctx->best_so_far_ant_solution, &ctx->best_so_far_ant_score );
 
-        if ( report ) fprintf(report,"%f \t %f\n",best_so_far_ant_score,elapsed_time(REAL));
-        if ( report_iter ) fprintf(report_iter,"%f \t %d\n",best_so_far_ant_score,iteration);
-        
-    	best_iteration = iteration;
-        restart_best = iteration;
-        best_time = time_used;
+    	ctx->best_iteration = ctx->iteration;
+        ctx->restart_best = ctx->iteration;
+        ctx->best_time = ctx->time_used;
+        write_report( ctx, REC_BEST );
 
-        trail_max = 1. / ( (rho) * best_so_far_ant_score );
-        trail_min = trail_max / ( 2. * n );
-        trail_0 = trail_max;
+        ctx->trail_max = 1. / ( (ctx->rho) * ctx->best_so_far_ant_score );
+        ctx->trail_min = ctx->trail_max / ( 2. * ctx->n );
+        ctx->trail_0 = ctx->trail_max;
 
     }
    
-    if ( iteration - restart_best > restart_iters ) {
+    /* the diversity pass costs as much as reading the colony once, it is
+       skipped unless a threshold or the log needs it */
+    if ( ctx->restart_diversity > 0.0 || ctx->log_stagnation )
+        ctx->diversity = colony_diversity( ctx );
+    if ( ctx->log_stagnation )
+        write_report( ctx, REC_ITER );
+
+    if ( ctx->iteration - ctx->restart_best > ctx->restart_iters || stagnated( ctx ) ) {
         /* MAX-MIN Ant System was the first ACO algorithm to use
          pheromone trail re-initialisation as implemented
          here. Other ACO algorithms may also profit from this mechanism.
          */
-        n_restarts++;
+        ctx->n_restarts++;
 
-        init_pheromone_trails( trail_0 );
-        restart_best = iteration;
-        restart_time = elapsed_time( REAL );
+        init_pheromone_trails( ctx, ctx->trail_0 );
+        ctx->restart_best = ctx->iteration;
+        ctx->restart_time = elapsed_time( ctx, REAL );
     }
     
 }
 
 
-void pheromone_trail_update( void )  
+void pheromone_trail_update( aco_context *ctx )
 /*    
       FUNCTION:       manage global pheromone trail update for the ACO algorithms
-      INPUT:          none
+      INPUT:          pointer to the try
       OUTPUT:         none
       (SIDE)EFFECTS:  pheromone trails are evaporated and pheromones are deposited 
  
 */
 {
   
-    /* Simulate the pheromone evaporation of all pheromones */
-    evaporation();
-
-    /* Apply the pheromone deposit for different ACO variants */
-    mmas_update();
-
-    /* Check pheromone trail limits for MMAS */
-    check_pheromone_trail_limits();
+    /* Evaporation, the MMAS deposit and the trail limits are applied
+       in one sweep, see fused_pheromone_update() */
+    mmas_update( ctx );
 
 }
 
 
-void mmas_update( void )
+void mmas_update( aco_context *ctx )
 /*
  FUNCTION:       manage global pheromone deposit for MAX-MIN Ant System
- INPUT:          none
+ INPUT:          pointer to the try
  OUTPUT:         none
- (SIDE)EFFECTS:  either the iteration-best or the best-so-far ant deposit pheromone
- on matrix "pheromone"
+ (SIDE)EFFECTS:  either the elite_ants iteration-best ants or the best-so-far ant
+ deposit pheromone on matrix "pheromone", after evaporation and before the trail
+ limits are enforced; with rank_deposit the ant of rank r deposits (k - r) / k of
+ its share; a migrant just taken from another island always deposits
  */
 {
     
-    int iteration_best_ant;
+    const uint64_t *solutions[MAX_ELITE];
+    double         d_tau[MAX_ELITE];
+    int            e, k;
    
-    if ( iteration % u_gb ) {
-        iteration_best_ant = find_best();
-        global_update_pheromone( &ant_solutions[iteration_best_ant * n], ant_scores[iteration_best_ant] );
+    if ( (ctx->iteration % ctx->u_gb) && !ctx->migrant_pending ) {
+        /* more ants are ranked than deposit when ls_ants > elite_ants */
+        k = ctx->top.n < ctx->elite_ants ? ctx->top.n : ctx->elite_ants;
+        for ( e = 0 ; e < k ; e++ ) {
+            solutions[e] = &ctx->ant_solutions[ctx->top.ant[e] * ctx->n_words];
+            d_tau[e] = 1.0 / ctx->top.score[e];
+            if ( ctx->rank_deposit )
+                d_tau[e] *= (double) (k - e) / k;
+        }
+        fused_pheromone_update( ctx, solutions, d_tau, k );
     }
     else {
-        global_update_pheromone( best_so_far_ant_solution, best_so_far_ant_score );
+        solutions[0] = ctx->best_so_far_ant_solution;
+        d_tau[0] = 1.0 / ctx->best_so_far_ant_score;
+        fused_pheromone_update( ctx, solutions, d_tau, 1 );
+        ctx->migrant_pending = 0;
     }
     
     
-    if ( ( iteration - restart_best ) < (int)(restart_iters/10) )
-        u_gb = 10;
-    else if ( (iteration - restart_best) < (int)(restart_iters/2) )
-        u_gb = 5;
-    else if ( (iteration - restart_best) < (int)(restart_iters/1.3) )
-        u_gb = 3;
-    else if ( (iteration - restart_best) < restart_iters )
-        u_gb = 2;
+    if ( ( ctx->iteration - ctx->restart_best ) < (int)(ctx->restart_iters/10) )
+        ctx->u_gb = 10;
+    else if ( (ctx->iteration - ctx->restart_best) < (int)(ctx->restart_iters/2) )
+        ctx->u_gb = 5;
+    else if ( (ctx->iteration - ctx->restart_best) < (int)(ctx->restart_iters/1.3) )
+        ctx->u_gb = 3;
+    else if ( (ctx->iteration - ctx->restart_best) < ctx->restart_iters )
+        ctx->u_gb = 2;
     else
-        u_gb = 1;
+        ctx->u_gb = 1;
 
     
 }
@@ -249,49 +413,143 @@ void mmas_update( void )
 /*
  Here is a "template" for the optimization function.
  */
-double aco_algorithm(){
+double aco_algorithm( aco_context *ctx ){
     
     double  score;
    
-    init_aco();
+    init_aco( ctx );
+
+    /* a try that already finished in the run being resumed is skipped */
+    if ( ctx->resume && load_checkpoint( ctx ) == CKPT_DONE ) {
+        ctx->stopped = 1;
+        exit_aco( ctx );
+        return( INFTY );
+    }
     
+    if ( ctx->async_colony )
+        run_async_colony( ctx );
+
     /* iterations */
-    while ( !termination_condition() ) {
+    while ( !ctx->async_colony && !termination_condition( ctx ) ) {
+
+        if ( run_stopped() ) {
+            ctx->stopped = 1;
+            break;
+        }
+
+        PHASE_BEGIN( ctx );
+
+        init_ant_rng( ctx );
+        if ( ctx->iteration == 1 ) init_ants( ctx );
+        else construct_solutions( ctx );
+
+        if ( ctx->ls_ants ) {
+            local_search( ctx );
+            PHASE_END( ctx, PH_LOCAL );
+        }
+
+        update_statistics( ctx );
+        PHASE_END( ctx, PH_STATISTICS );
 
-        if ( iteration == 1 ) init_ants();
-        else construct_solutions();
+        if ( ctx->migration && ctx->iteration % ctx->migration_interval == 0 ) {
+            migrate( ctx );
+            PHASE_END( ctx, PH_MIGRATE );
+        }
 
-        update_statistics();
+        pheromone_trail_update( ctx );
+        PHASE_END( ctx, PH_PHEROMONE );
 
-        pheromone_trail_update();
+        ctx->iteration++;
 
-        iteration++;
+        if ( checkpoint_due( ctx ) ) save_checkpoint( ctx, 0, 0 );
     }
+
+    /* last exchange, also tells the other islands when the optimal was found */
+    if ( ctx->migration && !ctx->stopped ) migrate( ctx );
+
+    /* a stopped try saves its state for --resume, a finished one is marked done */
+    if ( ctx->checkpoint_interval >= 0 ) save_checkpoint( ctx, !ctx->stopped, 1 );
     
-    score = best_so_far_ant_score;
-    exit_aco();
+    score = ctx->best_so_far_ant_score;
+    exit_aco( ctx );
     return(score);
 }
 
 
 /*************************    MAIN    *********************************/
 
+#ifndef ACO_NO_MAIN
+
 int main(int argc, char **argv) {
     
+    aco_params   params;
+    aco_instance instance;
+    aco_reports  reports;
+    aco_context  *contexts;
+    aco_arena    *arenas;
+    int          ntry, i;
+    char         *bench_file = NULL;
    
-    init_report ( );
-    
-    set_default_parameters ( );
-    read_parameters ( );
-    print_parameters ( );
+    set_default_parameters ( &params );
+    read_parameters ( &params );
+
+    /* aco <benchmark> [--resume] */
+    for ( i = 1 ; i < argc ; i++ ) {
+        if ( !strcmp(argv[i], "--resume") ) params.resume = 1;
+        else bench_file = argv[i];
+    }
+    if ( !bench_file ) {
+        printf("Usage: %s <benchmark> [--resume]\n", argv[0]);
+        exit(1);
+    }
+
+    print_parameters ( &params );
+    init_threads ( &params );
+    init_signals ( &params );
 
-    read_benchmark (argv[1]);
+    read_benchmark (bench_file, &instance);
+    instance.objective = &toymodel_objective;
+    instance.obj_state = instance.objective->init( &instance );
+    init_report ( &reports, instance.n, params.report_binary, params.resume );
 
-    for ( ntry = 0 ; ntry < max_tries ; ntry++ ) {
-	    printf("try %d\n",ntry);
-        aco_algorithm();
+    if ( params.n_islands > 1 )
+        run_islands( &params, &instance, &reports );
+    else {
+        if((contexts = (aco_context*) aligned_alloc(CACHE_LINE, sizeof( aco_context ) * params.max_tries)) == NULL ||
+           (arenas = (aco_arena*) malloc(sizeof( aco_arena ) * params.parallel_tries)) == NULL){
+            printf("Out of memory, exit.");
+            exit(1);
+        }
+        for ( i = 0 ; i < params.parallel_tries ; i++ )
+            init_arena( &arenas[i], params.huge_pages );
+
+        /* with parallel_tries > 1 every try runs on its own thread and the
+           colony loops inside it stay sequential (no nested parallelism) */
+        #pragma omp parallel for num_threads(params.parallel_tries) schedule(dynamic, 1) if ( params.parallel_tries > 1 )
+        for ( ntry = 0 ; ntry < params.max_tries ; ntry++ ) {
+	        printf("try %d\n",ntry);
+            int t = 0;
+#ifdef _OPENMP
+            t = omp_get_thread_num();
+#endif
+            init_context( &contexts[ntry], &params, &instance, &reports, &arenas[t], ntry );
+            aco_algorithm( &contexts[ntry] );
+        }
+        for ( i = 0 ; i < params.parallel_tries ; i++ )
+            exit_arena( &arenas[i] );
+        free( arenas );
+        free( contexts );
     }
 
+    exit_report( &reports );
+    instance.objective->teardown( instance.obj_state );
+    exit_benchmark( &instance );
+
+    if ( run_stopped() )
+        printf("stopped by SIGTERM, continue with %s %s --resume\n", argv[0], bench_file);
+
+    print_resource_usage();
     return (1);
 
 }
+#endif
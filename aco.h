@@ -6,6 +6,11 @@
  * @brief Header file for the program.
  */
 
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
 
 /***************************** ANTS **************************************/
 #define HEURISTIC(m,n)     (1.0 / ((double) 0.1))
@@ -16,60 +21,462 @@ zero */
 
 #define MAX_ANTS       1024    /* max no. of ants */
 
-extern int     *ant_solutions;     /* array with the colony solutions  - size n_ants * n   */
-extern double  *ant_scores;        /* array with the colony scores     - size n_ants       */
-
-extern int     *best_so_far_ant_solution;
-extern double  best_so_far_ant_score;
-
-//TO DO
-extern double   *pheromone;  /* pheromone matrix, two entries for each gate */
-
-extern int      n_ants;      /* number of ants */
-
-extern double   rho;         /* parameter for evaporation */
-extern double   q_0;         /* probability of best choice in tour construction */
-
-extern double   trail_max;   /* maximum pheromone trail in MMAS */
-extern double   trail_min;   /* minimum pheromone trail in MMAS */
-extern double   trail_0;     /* initial pheromone trail level */
-extern int      u_gb;        /* every u_gb iterations update with best-so-far ant */
-
-extern int      n; 		     /* problem size */
-
-extern int      *bs_optimum; /* problem optimal solution (for toy model) */
+#define MAX_ELITE      16      /* max no. of ants depositing in one iteration */
+
+/* the k best ants of an iteration, best first; ties go to the lower index */
+typedef struct {
+    int      n;
+    int      ant[MAX_ELITE];
+    double   score[MAX_ELITE];
+} top_ants;
+
+/* solutions are bit-packed, 64 gates per word; padding bits of the last
+   word are always kept to zero so that word-wise XOR/popcount is exact */
+#define WORD_BITS          64
+#define N_WORDS(n)         (((n) + WORD_BITS - 1) / WORD_BITS)
+/* largest problem size: the pheromone matrix, 2 entries per gate of every
+   whole word, is indexed with an int */
+#define MAX_GATES          ((1 << 30) - WORD_BITS)
+#define GET_GATE(s,i)      ((int) (((s)[(i) >> 6] >> ((i) & 63)) & 1))
+#define SET_GATE(s,i)      ((s)[(i) >> 6] |=  ((uint64_t) 1 << ((i) & 63)))
+#define CLEAR_GATE(s,i)    ((s)[(i) >> 6] &= ~((uint64_t) 1 << ((i) & 63)))
+#define FLIP_GATE(s,i)     ((s)[(i) >> 6] ^=  ((uint64_t) 1 << ((i) & 63)))
+
+/* choice table, refreshed whenever the pheromone matrix changes: gate i is
+   set to 0 when the low 32 bits of its random word are below
+   choice_threshold[i] = prob0 * 2^32; with probability q_0 (high 32 bits below
+   q_0_threshold) the greedy choice, packed in greedy_choice, is taken instead */
+#define FIXED_ONE          4294967296.0   /* 2^32 */
+
+/* storage precision of the pheromone matrix, chosen at build time with
+   PHER_FLAGS in the Makefile: -DPHEROMONE_FLOAT, -DPHEROMONE_FIXED32 or
+   -DPHEROMONE_FIXED16, double otherwise. The kernels compute in double and
+   convert on load (PHER_GET) and store (PHER_PUT); fused_pheromone_update()
+   computes in pher_real, float for the 16- and 32-bit types, so that the
+   narrower storage is not paid for in conversions. Fixed-point trails are
+   kept in units of pher_unit = trail_max / PHER_FIXED_MAX, set by each
+   update: only the ratio of the two trails of a gate reaches the choice
+   table, so a new trail_max just changes the unit of the next store. A
+   stored trail is at least one unit, which raises trail_min above
+   trail_max / (2n) once n > PHER_FIXED_MAX / 2 */
+#if defined(PHEROMONE_FIXED16)
+typedef uint16_t pher_t;
+typedef float    pher_real;
+#define PHER_FIXED_MAX     65534.0
+#elif defined(PHEROMONE_FIXED32)
+typedef int32_t  pher_t;
+typedef double   pher_real;
+#define PHER_FIXED_MAX     1073741824.0   /* 2^30 */
+#elif defined(PHEROMONE_FLOAT)
+typedef float    pher_t;
+typedef float    pher_real;
+#else
+typedef double   pher_t;
+typedef double   pher_real;
+#endif
+
+#ifdef PHER_FIXED_MAX
+#define PHER_UNIT(max)     ((max) / PHER_FIXED_MAX)
+#define PHER_GET(x,unit)   ((double) (x) * (unit))
+#define PHER_PUT(x,inv)    ((pher_t) (int32_t) ((x) * (inv) < 1.0 ? 1.0 : \
+                            (x) * (inv) > PHER_FIXED_MAX ? PHER_FIXED_MAX : (x) * (inv) + 0.5))
+#else
+#define PHER_UNIT(max)     1.0
+#define PHER_GET(x,unit)   ((void) (unit), (double) (x))
+#define PHER_PUT(x,inv)    ((void) (inv), (pher_t) (x))
+#endif
+
+/* per-ant random number stream, aligned to a cache line so that ants built
+   by different threads never share one */
+#define CACHE_LINE         64
+#define CACHE_ALIGNED      __attribute__((aligned(CACHE_LINE)))
+
+typedef struct {
+    uint64_t s[4][4];        /* xoshiro256** state, see UTILITIES */
+} CACHE_ALIGNED ant_rng_t;
 
 /***************************** IN-OUT **************************************/
 
 #define LINE_BUF_LEN     255
 
-extern int ntry;
-extern int max_tries;
-
-extern int iteration;    /* iteration counter */
-extern int best_iteration;
-extern int restart_best; 
-extern int n_restarts; 
-extern int max_iters;    /* maximum number of iterations */
-extern int restart_iters;
-
-extern double   max_time;     /* maximal allowed run time  */
-extern double   time_used;    /* time used until some given event */
-extern double   time_passed;  /* time passed until some moment*/
-extern double 	best_time;
-extern double 	restart_time;
-
-extern double optimal;      /* optimal solution value or bound to find */
-
-extern FILE *report_iter, *report, *final_report, *results_report;
-
-extern char name_buf[LINE_BUF_LEN];
-extern int  opt;
+/* parameter settings, read once from parameters.txt and copied into every try */
+typedef struct {
+    int      max_tries;
+    int      n_ants;         /* number of ants */
+    double   rho;            /* parameter for evaporation */
+    double   q_0;            /* probability of best choice in tour construction */
+    int      max_iters;      /* maximum number of iterations */
+    int      restart_iters;
+    double   max_time;       /* maximal allowed run time of a try */
+    double   optimal;        /* optimal solution value or bound to find */
+    int      u_gb;           /* every u_gb iterations update with best-so-far ant */
+    long int seed;
+    int      n_threads;      /* number of threads (0: runtime default) */
+    int      pin_threads;    /* pin thread i to core i */
+    int      parallel_tries; /* tries run at the same time, one thread each */
+    int      n_islands;      /* colonies cooperating in each try (island model) */
+    int      migration_interval; /* iterations between two migrations, at least 1 */
+    int      cache_size;     /* entries of the score cache, 0 disables it */
+    int      cache_verify;   /* keep full solutions in the cache to rule out collisions */
+    int      report_binary;  /* write the binary log instead of the text reports */
+    int      elite_ants;     /* iteration-best ants that deposit pheromone */
+    int      rank_deposit;   /* weight their deposit by rank instead of equally */
+    double   checkpoint_interval; /* seconds between checkpoints, 0: on signals only,
+                                     < 0: no checkpoints */
+    int      resume;         /* continue from the checkpoints (--resume) */
+    double   restart_pinned;    /* restart once this fraction of gates is pinned, 0: off */
+    double   restart_branching; /* restart once the branching factor drops below, 0: off */
+    double   restart_diversity; /* restart once the colony diversity drops below, 0: off */
+    int      log_stagnation;    /* write the convergence metrics of every iteration */
+    int      ls_ants;        /* iteration-best ants refined by local search, 0: off */
+    int      async_colony;   /* steady-state colony without the iteration barrier */
+    int      gate_parallel;  /* split the gates of each ant among the threads */
+    int      huge_pages;     /* colony arena: 0 small pages, 1 transparent, 2 explicit huge pages */
+} aco_params;
+
+struct aco_instance;
+
+/* objective function interface; the colony is always scored as a batch:
+   init:            builds the objective state for an instance, once per run
+   evaluate_batch:  scores n_ants packed solutions stored one after the other
+                    (n_words each) into scores[0 .. n_ants-1]
+   evaluate_word:   NULL, or for objectives that are a sum of independent
+                    per-gate terms, the sum of the terms of one packed word; the
+                    colony then scores each ant while it is built
+   evaluate_flip:   NULL, or the change of score if one gate of a solution is
+                    flipped, in O(1); without it the local search scores every
+                    flip with evaluate_batch
+   teardown:        releases the objective state
+   the state is shared by all tries running at the same time, so evaluation
+   must not modify it */
+typedef struct {
+    const char *name;
+    void    *(*init)( const struct aco_instance *inst );
+    void     (*evaluate_batch)( void *state, const uint64_t *solutions, int n_ants, double *scores );
+    double   (*evaluate_word)( void *state, int w, uint64_t word );
+    double   (*evaluate_flip)( void *state, const uint64_t *solution, int gate );
+    void     (*teardown)( void *state );
+} aco_objective;
+
+/* problem instance, read once and shared read-only by all tries */
+typedef struct aco_instance {
+    int      n;              /* problem size */
+    int      n_words;        /* words per packed solution */
+    uint64_t *bs_optimum;    /* problem optimal solution (for toy model), packed */
+    void     *map;           /* mapping of a binary benchmark, NULL for text files */
+    size_t   map_size;
+    const aco_objective *objective;
+    void     *obj_state;     /* built by objective->init */
+} aco_instance;
+
+/* binary benchmark format: this header and the packed optimum (n_words words)
+   at optimum_offset, 8-byte aligned so the file is used in place through mmap */
+#define BENCH_MAGIC        "ACOBENCH"
+#define BENCH_VERSION      1
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  flags;           /* 0, no optional sections are defined */
+    uint64_t  n;
+    uint64_t  checksum;        /* hash_solution() of the packed optimum */
+    uint64_t  optimum_offset;
+    uint64_t  reserved[3];
+} bench_header;
+
+/* phases of an iteration timed by the phase timers (see TIMER); with a
+   decomposable objective the evaluation is part of PH_CONSTRUCT */
+typedef enum { PH_CONSTRUCT, PH_EVALUATE, PH_LOCAL, PH_STATISTICS, PH_MIGRATE, PH_PHEROMONE,
+               N_PHASES } PHASE;
+
+/* per-try samples of one phase: log-linear histogram of the durations in ns,
+   PHASE_SUB buckets per power of two, so percentiles are within 25% */
+#define PHASE_SUB          4
+#define PHASE_BUCKETS      (PHASE_SUB * 64)
+
+typedef struct {
+    uint64_t  total_ns;
+    uint64_t  count;
+    uint32_t  hist[PHASE_BUCKETS];
+} phase_timer;
+
+/* what final_report shows of a phase timer */
+typedef struct {
+    int64_t  count;
+    double   total;            /* seconds */
+    double   mean, p50, p90, p99;  /* microseconds */
+    int64_t  reserved[2];
+} phase_summary;
+
+/* report records: the tries queue them in a ring of fixed-size slots and a
+   writer thread turns them into the text reports or appends them, as they
+   are, to the binary log; a REC_FINAL record is followed by N_PHASES slots
+   with the phase timers and REC_PAYLOAD_SLOTS slots with the packed best
+   solution */
+#define REC_TRY            0    /* a try starts */
+#define REC_BEST           1    /* new best-so-far solution */
+#define REC_FINAL          2    /* a try ends */
+#define REC_ITER           3    /* convergence metrics of an iteration */
+
+#define REPORT_RING_SLOTS  4096 /* minimum, rounded up to hold a REC_FINAL */
+#define REC_WORDS          8    /* solution words per payload slot */
+#define REC_PAYLOAD_SLOTS(n_words)  (((n_words) + REC_WORDS - 1) / REC_WORDS)
+#define REC_FINAL_SLOTS(n_words)    (1 + N_PHASES + REC_PAYLOAD_SLOTS( n_words ))
+
+typedef struct {
+    int32_t  type;
+    int32_t  ntry;
+    int32_t  island;           /* -1 outside the island model */
+    int32_t  iteration;
+    int32_t  best_iteration;
+    int32_t  restarts;
+    double   score;
+    double   time;
+    double   best_time;
+    int64_t  cache_hits;       /* -1 without score cache */
+    int64_t  cache_misses;
+} report_record;
+
+typedef struct {
+    int32_t  type;             /* REC_ITER */
+    int32_t  ntry;
+    int32_t  island;
+    int32_t  iteration;
+    double   time;
+    double   best_score;
+    double   iteration_score;
+    double   pinned, branching, diversity;
+} stagnation_record;
+
+typedef union {
+    report_record rec;
+    stagnation_record stag;
+    phase_summary phase;
+    uint64_t      words[REC_WORDS];
+} report_slot;
+
+/* binary log: this header, then report_slot records in the order they were written */
+#define LOG_MAGIC          "ACOLOG\0\0"
+#define LOG_VERSION        2
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  slot_size;
+    int32_t   n;
+    int32_t   n_words;
+    int32_t   n_phases;
+    int32_t   reserved;
+} log_header;
+
+/* output files and the record ring, shared by all tries; producers claim
+   slots with a CAS on tail, the writer thread alone advances head */
+typedef struct {
+    FILE *report_iter, *report, *final_report, *results_report;
+    FILE *log;                     /* binary log, replaces the text files */
+    FILE *stagnation;              /* opened on the first REC_ITER */
+    int  append;
+    int  n, n_words;
+    report_slot     *slots;
+    _Atomic size_t  *seq;          /* per-slot sequence number */
+    size_t          mask;
+    CACHE_ALIGNED _Atomic size_t tail;
+    CACHE_ALIGNED size_t         head;
+    _Atomic long    stalls;        /* pushes that found the ring full */
+    _Atomic int     stop;
+    pthread_t       writer;
+    phase_summary   phases[N_PHASES];  /* REC_FINAL payload being gathered */
+    uint64_t        *solution;
+    char            *line;         /* text of a solution */
+} aco_reports;
+
+/* shared-memory migration area of the island model: the best solution found
+   so far by any island of the try, and a flag raised once one reaches optimal */
+typedef struct {
+    pthread_mutex_t lock;
+    _Atomic int     done;
+    double          best_score;
+    int             best_island;
+    uint64_t        *best_solution;  /* size n_words */
+} migration_area;
+
+/* fixed-memory cache of solution scores, so that ants that rebuild an already
+   evaluated solution skip the objective; CACHE_WAYS-way set associative, the
+   set is picked by the solution hash and a full set evicts with the clock
+   algorithm. With verification the whole solution is stored and compared,
+   otherwise equal 64-bit hashes are taken as equal solutions */
+#define CACHE_WAYS         4
+
+typedef struct {
+    int       n_sets;
+    int       n_words;       /* words per stored key, 0 without verification */
+    uint64_t  *hashes;       /* size n_sets * CACHE_WAYS */
+    double    *scores;
+    uint8_t   *state;        /* 0 empty, 1 valid, 2 valid and referenced */
+    uint8_t   *hands;        /* clock hand of each set */
+    uint64_t  *keys;         /* size n_sets * CACHE_WAYS * n_words, or NULL */
+    uint64_t  *batch;        /* distinct solutions not found, evaluated in one batch */
+    uint64_t  *batch_hashes;
+    double    *batch_scores;
+    int       *ant_batch;    /* batch entry of each ant, -1 when found */
+    long      hits, misses;
+} score_cache;
+
+/* colony buffers of a try, carved from an arena that outlives the tries:
+   every thread that runs tries owns one, so the pages are mapped (and placed
+   on the NUMA node of the thread that touches them first) once per run and
+   reused by the next try; blocks are CACHE_LINE aligned. The arena only
+   grows, see arena_reset() */
+#define HUGE_PAGE_SIZE     ((size_t) 2 << 20)
+
+typedef struct {
+    char      *base;         /* anonymous mapping, NULL before the first try */
+    size_t    size;
+    size_t    used;
+    int       huge_pages;    /* see aco_params */
+} aco_arena;
+
+/* steady-state colony, see async.c: workers build ants from the front choice
+   table and submit them to the colony being filled; the worker completing it
+   becomes the updater, which works on that colony while the others fill the
+   other one, and publishes the next choice table by switching front. A
+   buffer is only rewritten once no worker builds from it any more */
+typedef struct {
+    uint32_t        *threshold[2];   /* double-buffered choice table */
+    uint64_t        *greedy[2];
+    _Atomic int     front;           /* buffer the workers build from */
+    _Atomic int     readers[2];      /* workers building from each buffer */
+    uint64_t        *solutions[2];   /* double-buffered colony */
+    double          *scores[2];
+    pthread_mutex_t lock;            /* guards the colony being filled */
+    pthread_cond_t  changed;         /* a colony was handed over, or its update ended */
+    int             filling;         /* colony being filled */
+    int             count;           /* ants submitted to it */
+    top_ants        top;             /* and their ranking */
+    int             updating;        /* an updater works on the other colony */
+    _Atomic int     done;
+    int             n_workers;
+    ant_rng_t       *rng;            /* one stream per worker */
+    uint64_t        *scratch;        /* one solution per worker */
+} async_state;
+
+/* the whole state of one try; fields are grouped by access pattern and each
+   group starts on its own cache line, so tries running on different cores
+   never write to a line another one reads */
+typedef struct {
+
+    /* hot: read at every gate by the construction, evaluation and update kernels */
+    struct CACHE_ALIGNED {
+        int       n;
+        int       n_words;
+        int       n_ants;
+        double    rho;
+        double    trail_max;         /* maximum pheromone trail in MMAS */
+        double    trail_min;         /* minimum pheromone trail in MMAS */
+        uint64_t  q_0_threshold;
+        pher_t    *pheromone;        /* pheromone matrix, two entries for each gate */
+        double    pher_unit;         /* value of one fixed-point step, 1 otherwise */
+        uint32_t  *choice_threshold; /* size n */
+        uint64_t  *greedy_choice;    /* size n_words */
+        uint64_t  *ant_solutions;    /* colony solutions - size n_ants * n_words */
+        double    *ant_scores;       /* colony scores    - size n_ants */
+        ant_rng_t *ant_rng;          /* random number streams - size n_ants */
+        const aco_objective *objective;
+        void      *obj_state;
+    };
+
+    /* warm: updated once per iteration */
+    struct CACHE_ALIGNED {
+        int       iteration;         /* iteration counter */
+        int       best_iteration;
+        int       restart_best;
+        int       n_restarts;
+        int       u_gb;
+        double    trail_0;           /* initial pheromone trail level */
+        uint64_t  *best_so_far_ant_solution;
+        double    best_so_far_ant_score;
+        int       migrant_pending;   /* best-so-far came from another island */
+        int       elite_ants;
+        int       rank_deposit;
+        int       ls_ants;
+        int       top_k;             /* ants ranked: max( elite_ants, ls_ants ) */
+        top_ants  top;               /* ranked while the colony is evaluated */
+        double    pinned;            /* fraction of gates with a trail at trail_min */
+        double    branching;         /* lambda-branching factor, in [1, 2] */
+        double    diversity;         /* mean distance to the iteration-best ant, per gate */
+        score_cache *cache;          /* NULL when disabled */
+    };
+
+    /* cold: settings, timers and bookkeeping */
+    struct CACHE_ALIGNED {
+        int       ntry;
+        double    q_0;
+        int       max_iters;
+        int       restart_iters;
+        double    max_time;
+        double    optimal;
+        long int  seed;
+        double    time_used;         /* time used until some given event */
+        double    time_passed;       /* time passed until some moment */
+        double    best_time;
+        double    restart_time;
+        double    start_real_time;   /* see start_timers() */
+        double    start_virtual_time;
+        aco_reports *reports;
+        int       island;            /* island index, 0 without island model */
+        int       migration_interval;
+        migration_area *migration;   /* NULL without island model */
+        int       cache_size;
+        int       cache_verify;
+        double    checkpoint_interval;
+        int       resume;
+        int       stopped;           /* not run to its end by this process */
+        double    last_checkpoint;
+        unsigned  checkpoint_seen;   /* last SIGUSR1 request handled */
+        char      checkpoint_file[64];
+        char      *checkpoint_buf;   /* snapshot being written, see CHECKPOINT */
+        size_t    checkpoint_size;
+        pthread_t checkpoint_writer;
+        int       checkpoint_started;
+        _Atomic int checkpoint_busy;
+        double    restart_pinned;
+        double    restart_branching;
+        double    restart_diversity;
+        int       log_stagnation;
+        int       async_colony;
+        async_state *async;          /* NULL outside run_async_colony() */
+        int       gate_parallel;
+        aco_arena *arena;            /* holds the colony buffers, see allocate_ants() */
+        int       n_blocks;          /* gate blocks of a solution, see GATE_BLOCK_WORDS */
+        double    *block_scores;     /* partial scores of one ant - size n_blocks * BLOCK_SCORE_STRIDE */
+    };
+
+    /* phase timers, written once per phase */
+    struct CACHE_ALIGNED {
+        uint64_t    phase_start;     /* end of the previous phase, ns */
+        phase_timer phases[N_PHASES];
+    };
+
+} aco_context;
 
 /***************************** TIMER **************************************/
 
 typedef enum type_timer {REAL, VIRTUAL} TIMER_TYPE;
 
+/* max_time is checked every DEADLINE_CHECK iterations only */
+#define DEADLINE_CHECK     8
+
+/* phase timers, compiled in with -DPHASE_TIMERS: PHASE_BEGIN marks the start
+   of an iteration, PHASE_END charges the time since the previous mark to a
+   phase, so consecutive phases cost one clock read each */
+#ifdef PHASE_TIMERS
+#define PHASE_BEGIN(ctx)     ((ctx)->phase_start = monotonic_ns())
+#define PHASE_END(ctx, ph)   phase_sample( &(ctx)->phases[ph], &(ctx)->phase_start )
+#else
+#define PHASE_BEGIN(ctx)     ((void) 0)
+#define PHASE_END(ctx, ph)   ((void) 0)
+#endif
+
 /***************************** UTILITIES **************************************/
 
 #define INFTY                 LONG_MAX
@@ -82,64 +489,247 @@ typedef enum type_timer {REAL, VIRTUAL} TIMER_TYPE;
 #define IQ 127773
 #define IR 2836
 
-extern long int seed;
-
 double ran01 ( long *idum );
 
-double * generate_double_matrix( int n, int m);
+/* xoshiro256** run as RNG_LANES interleaved generators: the state is stored
+   lane-minor so one step of all lanes is a plain loop the compiler turns into
+   SIMD code; batches are produced RNG_LANES numbers at a time */
+
+#define RNG_LANES      4
+#define RNG_TO_01(x)   ((double) ((x) >> 11) * 0x1.0p-53)
+
+void rng_seed ( ant_rng_t *r, uint64_t seed, uint64_t stream );
+
+void rng_fill_bits ( ant_rng_t *r, uint64_t *buf, int count );
+
+void rng_fill_01 ( ant_rng_t *r, double *buf, int count );
+
+
+/***************************** ACO **************************************/
+
+void init_context ( aco_context *ctx, const aco_params *p, const aco_instance *inst,
+                    aco_reports *reports, aco_arena *arena, int ntry );
+
+double aco_algorithm ( aco_context *ctx );
 
+void init_aco ( aco_context *ctx );
+
+void exit_aco ( aco_context *ctx );
+
+void init_ants ( aco_context *ctx );
 
 /***************************** ANTS **************************************/
 
-int termination_condition ( void );
+int termination_condition ( aco_context *ctx );
 
-void construct_solutions ( void );
+void construct_solutions ( aco_context *ctx );
 
-void update_statistics ( void );
+void update_statistics ( aco_context *ctx );
 
-void pheromone_trail_update ( void );
+void pheromone_trail_update ( aco_context *ctx );
 
-void mmas_update ( void );
+void mmas_update ( aco_context *ctx );
 
-void check_pheromone_trail_limits( void );
+void check_pheromone_trail_limits( aco_context *ctx );
 
-void init_pheromone_trails ( double initial_trail );
+void init_pheromone_trails ( aco_context *ctx, double initial_trail );
 
-void evaporation ( void );
+void evaporation ( aco_context *ctx );
 
-void global_update_pheromone( int *solutions, double score );
+void global_update_pheromone( aco_context *ctx, uint64_t *solutions, double score );
 
-void select_gate( int k, int gate );
+/* below this many gates the fused update runs on a single thread */
+#define PAR_UPDATE_MIN_GATES   (1 << 18)
 
-int find_best ( void );
+/* convergence metrics, see fused_pheromone_update(): a gate is pinned when
+   one of its trails is at trail_min, and counts twice in the branching
+   factor when both trails exceed trail_min + LAMBDA_BRANCHING * (trail_max -
+   trail_min); early restarts wait STAGNATION_MIN_ITERS after the last one */
+#define LAMBDA_BRANCHING       0.05
+#define STAGNATION_MIN_ITERS   10
 
-void copy_from_to(int *solution1, double score1, int *solution2, double *score2);
+/* below this many ants the colony is ranked on a single thread */
+#define PAR_RANK_MIN_ANTS      (1 << 12)
 
-void allocate_ants ( void );
+/* with gate_parallel, the ants are built one at a time and the threads share
+   the blocks of GATE_BLOCK_WORDS words of each; block b of ant k draws from
+   a stream seeded by (a key drawn from the stream of ant k, b), so the
+   solutions do not depend on the number of threads */
+#define GATE_BLOCK_WORDS       256
 
-/***************************** IN-OUT **************************************/
+/* the partial score of block b is block_scores[b * BLOCK_SCORE_STRIDE], one
+   cache line each, so threads building neighbouring blocks share none */
+#define BLOCK_SCORE_STRIDE     (CACHE_LINE / sizeof( double ))
+
+void fused_pheromone_update( aco_context *ctx, const uint64_t * const *solutions,
+                             const double *d_tau, int n_dep );
+
+void compute_choice_table ( aco_context *ctx );
+
+double construct_ant ( aco_context *ctx, ant_rng_t *rng, const uint32_t *choice_threshold,
+                       const uint64_t *greedy_choice, uint64_t *solution );
+
+double construct_words ( aco_context *ctx, ant_rng_t *rng, const uint32_t *choice_threshold,
+                         const uint64_t *greedy_choice, uint64_t *solution, int w0, int w1 );
+
+void construct_ant_blocks ( aco_context *ctx, int k, int uniform );
+
+uint64_t construct_word( aco_context *ctx, const uint32_t *choice_threshold,
+                         const uint64_t *greedy_choice, int w, const uint64_t *rnd );
+
+void select_gate( aco_context *ctx, int k, int gate, uint64_t rnd );
+
+int find_best ( aco_context *ctx );
+
+void top_insert ( top_ants *t, int k, int ant, double score );
 
-void set_default_parameters();
+void top_merge ( top_ants *dst, const top_ants *src, int k );
 
-void read_parameters();
+void rank_colony ( aco_context *ctx );
 
-void init_report();
+double colony_diversity ( aco_context *ctx );
 
-void write_report();
+void copy_from_to( aco_context *ctx, uint64_t *solution1, double score1, uint64_t *solution2, double *score2 );
 
-void print_parameters ( void );
+void allocate_ants ( aco_context *ctx );
 
-void fprintSolution ( int *t);
+void init_ant_rng ( aco_context *ctx );
+
+/***************************** IN-OUT **************************************/
+
+void set_default_parameters( aco_params *p );
+
+void read_parameters( aco_params *p );
+
+void write_report( aco_context *ctx, int type );
+
+void print_parameters ( const aco_params *p );
+
+void init_threads ( const aco_params *p );
 
 /***************************** TIMER **************************************/
 
-void start_timers(void);
+void start_timers( aco_context *ctx );
+
+double elapsed_time( aco_context *ctx, TIMER_TYPE type );
+
+uint64_t monotonic_ns ( void );
+
+void phase_sample ( phase_timer *t, uint64_t *start );
+
+void phase_summaries ( const aco_context *ctx, phase_summary *out );
 
-double elapsed_time(TIMER_TYPE type);
+
+/***************************** REPORTS **************************************/
+
+void init_report ( aco_reports *r, int n, int binary, int append );
+
+void exit_report ( aco_reports *r );
+
+void queue_record ( aco_reports *r, const report_record *rec, const phase_summary *phases,
+                     const uint64_t *solution );
+
+void print_record ( aco_reports *r, const report_record *rec, const phase_summary *phases,
+                     const uint64_t *solution );
+
+void fprintSolution ( aco_reports *r, int ntry, const uint64_t *t );
+
+
+/***************************** CHECKPOINT **************************************/
+
+/* checkpoint of a try: this header and, unless done, the pheromone matrix
+   (2n), the best-so-far solution (n_words) and the phase timers; the random
+   streams are not stored, they are seeded again from the iteration (see
+   init_ant_rng()). A done checkpoint only tells --resume to skip the try */
+#define CKPT_MAGIC         "ACOCKPT"
+#define CKPT_VERSION       5
+
+#define CKPT_NONE          0    /* no usable checkpoint, the try starts afresh */
+#define CKPT_RESUMED       1
+#define CKPT_DONE          2
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    int32_t   done;
+    int32_t   n, n_ants, ntry, island;
+    int32_t   iteration, best_iteration, restart_best, n_restarts, u_gb, pher_size;
+    int32_t   migrant_pending, reserved;
+    double    trail_0, trail_min, trail_max, pher_unit;
+    double    pinned, branching;       /* of the last update, see stagnated() */
+    double    best_score, best_time, restart_time, elapsed;
+} checkpoint_header;
+
+void init_signals ( const aco_params *p );
+
+int run_stopped ( void );
+
+int checkpoint_due ( aco_context *ctx );
+
+void save_checkpoint ( aco_context *ctx, int done, int wait );
+
+int load_checkpoint ( aco_context *ctx );
+
+void exit_checkpoint ( aco_context *ctx );
+
+
+/***************************** ISLANDS **************************************/
+
+void init_migration ( migration_area *m, int n_words );
+
+void exit_migration ( migration_area *m );
+
+void migrate ( aco_context *ctx );
+
+void run_islands ( const aco_params *p, const aco_instance *inst, aco_reports *reports );
+
+
+/***************************** LOCAL SEARCH **************************************/
+
+void local_search ( aco_context *ctx );
+
+
+/***************************** ASYNC **************************************/
+
+void run_async_colony ( aco_context *ctx );
+
+
+/***************************** ARENA **************************************/
+
+void init_arena ( aco_arena *a, int huge_pages );
+
+void arena_reset ( aco_arena *a, size_t size );
+
+void * arena_alloc ( aco_arena *a, size_t size );
+
+void exit_arena ( aco_arena *a );
+
+void print_resource_usage ( void );
+
+
+/***************************** CACHE **************************************/
+
+score_cache * init_cache ( int entries, int n_words, int n_ants, int verify );
+
+void exit_cache ( score_cache *c );
+
+uint64_t hash_solution ( const uint64_t *solution, int n_words );
+
+int cache_lookup ( score_cache *c, const uint64_t *solution, uint64_t hash, double *score );
+
+void cache_insert ( score_cache *c, const uint64_t *solution, uint64_t hash, double score );
+
+void evaluate_colony ( aco_context *ctx );
 
 
 /***************************** TOYMODEL **************************************/
 
-double obj_function ( int k );
+extern const aco_objective toymodel_objective;
+
+double obj_function ( void *state, const uint64_t *solution );
+
+void read_benchmark ( char *c, aco_instance *inst );
+
+void write_benchmark_binary ( char *c, const aco_instance *inst );
 
-void read_benchmark ( char *c );
+void exit_benchmark ( aco_instance *inst );
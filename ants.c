@@ -8,86 +8,186 @@
  
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 #include <limits.h>
 #include <time.h>
 #include "aco.h"
 
-int * ant_solutions;            /* size [n_ants * n] */
-int * best_so_far_ant_solution; /* size [n] */
+void allocate_ants ( aco_context *ctx )
+/*    
+      FUNCTION:       allocate the memory for the ant colony, the best-so-far ant
+                      and the pheromone trails
+      INPUT:          pointer to the try
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the buffers are carved from the arena of the try, which
+                      releases those of the previous try. Solutions are
+                      cleared here, so that the padding bits of the last word
+                      stay clear, by the threads that build the ants (same
+                      static schedule as construct_solutions()), so that with
+                      first-touch placement each ant lives on the NUMA node
+                      of its thread; the trails are first touched by
+                      init_pheromone_trails()
+*/
+{
+    const size_t n_ants = ctx->n_ants, n = ctx->n, n_words = ctx->n_words;
+    int    k;
 
-double * ant_scores;            /* size [n_ants] */
-double best_so_far_ant_score;   /* just the best */
+    ctx->n_blocks = (ctx->n_words + GATE_BLOCK_WORDS - 1) / GATE_BLOCK_WORDS;
 
-double   *pheromone;
+    /* each block may lose up to CACHE_LINE bytes to alignment */
+    arena_reset( ctx->arena, sizeof( uint64_t ) * n_ants * n_words + sizeof( double ) * n_ants +
+                             sizeof( ant_rng_t ) * n_ants + sizeof( double ) * ctx->n_blocks * BLOCK_SCORE_STRIDE +
+                             sizeof( uint64_t ) * n_words + sizeof( pher_t ) * 2 * n +
+                             sizeof( uint32_t ) * n + sizeof( uint64_t ) * n_words +
+                             8 * CACHE_LINE );
 
-int n_ants;                     /* number of ants */
+    /* ANTS */
+    ctx->ant_solutions = (uint64_t*) arena_alloc( ctx->arena, sizeof( uint64_t ) * n_ants * n_words );
+    ctx->ant_scores    = (double*) arena_alloc( ctx->arena, sizeof( double ) * n_ants );
+    ctx->ant_rng       = (ant_rng_t*) arena_alloc( ctx->arena, sizeof( ant_rng_t ) * n_ants );
+    ctx->block_scores  = (double*) arena_alloc( ctx->arena, sizeof( double ) * ctx->n_blocks *
+                                                            BLOCK_SCORE_STRIDE );
 
-double rho;                     /* parameter for evaporation */
-double q_0;                     /* probability of best choice in tour construction */
+    #pragma omp parallel for schedule(static)
+    for ( k = 0 ; k < ctx->n_ants ; k++ )
+        memset( &ctx->ant_solutions[k * n_words], 0, sizeof( uint64_t ) * n_words );
 
-double   trail_max;             /* maximum pheromone trail in MMAS */
-double   trail_min;             /* minimum pheromone trail in MMAS */
-double   trail_0;               /* initial pheromone level */
-int     u_gb;
+    /* BEST ANT */
+    ctx->best_so_far_ant_solution = (uint64_t*) arena_alloc( ctx->arena, sizeof( uint64_t ) * n_words );
+    memset( ctx->best_so_far_ant_solution, 0, sizeof( uint64_t ) * n_words );
 
-int n;		                    /* problem size */
+    /* PHEROMONE and the choice table built from it */
+    ctx->pheromone        = (pher_t*) arena_alloc( ctx->arena, sizeof( pher_t ) * 2 * n );
+    ctx->choice_threshold = (uint32_t*) arena_alloc( ctx->arena, sizeof( uint32_t ) * n );
+    ctx->greedy_choice    = (uint64_t*) arena_alloc( ctx->arena, sizeof( uint64_t ) * n_words );
+}
 
 
-void allocate_ants ( void )
+
+void init_ant_rng( aco_context *ctx )
 /*    
-      FUNCTION:       allocate the memory for the ant colony, the best-so-far and 
-                      the iteration best ant
-      INPUT:          none
+      FUNCTION:       give every ant its own random number stream for the iteration
+      INPUT:          pointer to the try
       OUTPUT:         none
-      (SIDE)EFFECTS:  allocation of memory for the ant colony and two ants that 
-                      store intermediate tours
-
+      (SIDE)EFFECTS:  stream of ant k in try ntry is derived from (seed, ntry, island,
+                      iteration, k), so with a fixed seed a try is reproducible
+                      whatever the number of threads, and an iteration does
+                      not depend on how many numbers the previous one drew
 */
 {
+    int      k;
+    uint64_t seed = (uint64_t) ctx->seed ^ ((uint64_t) ctx->iteration * 0xD6E8FEB86659FD93ULL);
 
-    /* ANTS */
-    if((ant_solutions = (int*) malloc(sizeof( int ) * n_ants * n)) == NULL){
-        printf("Out of memory, exit.");
-        exit(1);
+    for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+        rng_seed( &ctx->ant_rng[k], seed,
+                  ((uint64_t) ctx->ntry << 48) | ((uint64_t) ctx->island << 32) | (uint64_t) k );
     }
+}
 
-    if((ant_scores = (double*) malloc(sizeof( double ) * n_ants)) == NULL){
-        printf("Out of memory, exit.");
-        exit(1);
-    }
 
-    /* BEST ANT */
-    if((best_so_far_ant_solution = (int*) malloc(sizeof( int ) * n)) == NULL){
-        printf("Out of memory, exit.");
-        exit(1);
-    }
 
+int find_best( aco_context *ctx )
+/*    
+      FUNCTION:       find the best ant of the current iteration
+      INPUT:          pointer to the try
+      OUTPUT:         index of solution array containing the iteration best ant
+      (SIDE)EFFECTS:  none; the colony is ranked when it is evaluated, see
+                      rank_colony()
+*/
+{
+    return ctx->top.ant[0];
+}
+
+
+void top_insert( top_ants *t, int k, int ant, double score )
+/*    
+      FUNCTION:       offer an ant to a top-k list
+      INPUT:          pointer to the list, its capacity k, the ant and its score
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the ant is inserted in order if it is among the k best;
+                      ants are ordered by score, then by index, so the result
+                      does not depend on the order of the offers
+*/
+{
+    int i;
+
+    if ( t->n == k && (score > t->score[k - 1] ||
+                       (score == t->score[k - 1] && ant > t->ant[k - 1])) )
+        return;
+    i = (t->n < k) ? t->n++ : k - 1;
+    for ( ; i > 0 && (score < t->score[i - 1] ||
+                      (score == t->score[i - 1] && ant < t->ant[i - 1])) ; i-- ) {
+        t->score[i] = t->score[i - 1];
+        t->ant[i]   = t->ant[i - 1];
+    }
+    t->score[i] = score;
+    t->ant[i]   = ant;
 }
 
 
+void top_merge( top_ants *dst, const top_ants *src, int k )
+/*    
+      FUNCTION:       merge two top-k lists
+      INPUT:          pointers to the lists and their capacity k
+      OUTPUT:         none
+      (SIDE)EFFECTS:  dst holds the k best ants of both
+*/
+{
+    int i;
+
+    for ( i = 0 ; i < src->n ; i++ )
+        top_insert( dst, k, src->ant[i], src->score[i] );
+}
 
-int find_best( void )
+
+double colony_diversity( aco_context *ctx )
 /*    
-      FUNCTION:       find the best ant of the current iteration
-      INPUT:          none
-      OUTPUT:         index of solution array containing the iteration best ant
+      FUNCTION:       diversity of the colony
+      INPUT:          pointer to the try, after the colony is ranked
+      OUTPUT:         mean Hamming distance of the ants to the iteration-best
+                      ant, divided by n: 0 once the colony has converged
       (SIDE)EFFECTS:  none
 */
 {
-    double   min;
-    int   k, k_min;
-
-    min = ant_scores[0];
-    k_min = 0;
-    for( k = 1 ; k < n_ants ; k++ ) {
-        if( ant_scores[k] < min ) {
-            min = ant_scores[k];
-            k_min = k;
-        }
+    int      k, w;
+    const int n_words = ctx->n_words;
+    const uint64_t *best = &ctx->ant_solutions[find_best( ctx ) * n_words], *s;
+    uint64_t dist = 0;
+
+    for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+        s = &ctx->ant_solutions[k * n_words];
+        for ( w = 0 ; w < n_words ; w++ )
+            dist += __builtin_popcountll( s[w] ^ best[w] );
+    }
+    return (double) dist / ((double) ctx->n_ants * ctx->n);
+}
+
+
+void rank_colony( aco_context *ctx )
+/*    
+      FUNCTION:       find the top_k best ants of the colony
+      INPUT:          pointer to the try
+      OUTPUT:         none
+      (SIDE)EFFECTS:  ctx->top is rebuilt from ant_scores; each thread ranks
+                      its share of the colony and the lists are merged
+*/
+{
+    int k;
+
+    ctx->top.n = 0;
+    #pragma omp parallel if ( ctx->n_ants >= PAR_RANK_MIN_ANTS )
+    {
+        top_ants local;
+
+        local.n = 0;
+        #pragma omp for schedule(static)
+        for ( k = 0 ; k < ctx->n_ants ; k++ )
+            top_insert( &local, ctx->top_k, k, ctx->ant_scores[k] );
+        #pragma omp critical
+        top_merge( &ctx->top, &local, ctx->top_k );
     }
-    return k_min;
 }
 
 
@@ -98,66 +198,76 @@ Procedures for pheromone manipulation
  ************************************************************/
 
 
-void check_pheromone_trail_limits( void )
+void check_pheromone_trail_limits( aco_context *ctx )
 /*
  FUNCTION:      MMAS keeps pheromone trails inside trail limits
- INPUT:         none
+ INPUT:         pointer to the try
  OUTPUT:        none
  (SIDE)EFFECTS: pheromones are forced to interval [trail_min,trail_max]
  */
 {
     int i, j;
+    double p, unit = ctx->pher_unit, inv = 1.0 / unit;
     
-    for ( i = 0 ; i < n ; i++ ) {
+    for ( i = 0 ; i < ctx->n ; i++ ) {
         for ( j = 0 ; j < 2 ; j++ ) {
-            if ( pheromone[i * 2 + j] < trail_min ) {
-                pheromone[i * 2 + j] = trail_min;
-            } else if ( pheromone[i * 2 + j] > trail_max ) {
-                pheromone[i * 2 + j] = trail_max;
+            p = PHER_GET( ctx->pheromone[i * 2 + j], unit );
+            if ( p < ctx->trail_min ) {
+                ctx->pheromone[i * 2 + j] = PHER_PUT( ctx->trail_min, inv );
+            } else if ( p > ctx->trail_max ) {
+                ctx->pheromone[i * 2 + j] = PHER_PUT( ctx->trail_max, inv );
             }
         }
     }
 }
 
 
-void init_pheromone_trails( double initial_trail )
+void init_pheromone_trails( aco_context *ctx, double initial_trail )
 /*
  FUNCTION:      initialize pheromone trails
- INPUT:         initial value of pheromone trails "initial_trail"
+ INPUT:         pointer to the try and initial value of pheromone trails "initial_trail"
  OUTPUT:        none
- (SIDE)EFFECTS: pheromone matrix is reinitialized
+ (SIDE)EFFECTS: pheromone matrix is reinitialized; fixed-point trails get a
+                unit that fits both initial_trail and trail_max
  */
 {
     int i, j;
+    pher_t p;
     
-    /* Initialize pheromone trails */
-    for ( i = 0 ; i < n ; i++ ) {
+    ctx->pher_unit = PHER_UNIT( fmax( initial_trail, ctx->trail_max ) );
+    p = PHER_PUT( initial_trail, 1.0 / ctx->pher_unit );
+
+    /* Initialize pheromone trails, split like fused_pheromone_update() */
+    #pragma omp parallel for if ( ctx->n >= PAR_UPDATE_MIN_GATES ) schedule(static) private(j)
+    for ( i = 0 ; i < ctx->n ; i++ ) {
         for ( j = 0 ; j < 2 ; j++ ) {
-            pheromone[i * 2 + j] = initial_trail;
+            ctx->pheromone[i * 2 + j] = p;
         }
     }
 }
 
 
-void evaporation( void )
+void evaporation( aco_context *ctx )
 /*    
       FUNCTION:      implements the pheromone trail evaporation
-      INPUT:         none
+      INPUT:         pointer to the try
       OUTPUT:        none
       (SIDE)EFFECTS: pheromones are reduced by factor rho
 */
 { 
     int    i, j;
+    double p, unit = ctx->pher_unit, inv = 1.0 / unit;
 
-    for ( i = 0 ; i < n ; i++ ) {
+    for ( i = 0 ; i < ctx->n ; i++ ) {
         for ( j = 0 ; j < 2 ; j++ ) {
-            pheromone[i * 2 + j] = (1 - rho) * pheromone[i * 2 + j];
+            p = (1 - ctx->rho) * PHER_GET( ctx->pheromone[i * 2 + j], unit );
+            ctx->pheromone[i * 2 + j] = PHER_PUT( p, inv );
         }
     }
 }
 
 
-void global_update_pheromone( int *solutions, double score )
+void global_update_pheromone( aco_context *ctx, uint64_t *solutions, double score )
 /*    
       FUNCTION:      reinforces edges used in ant k's solution
       INPUT:         index k of the ant that updates the pheromone trail [0, n_ants]
@@ -166,17 +276,119 @@ void global_update_pheromone( int *solutions, double score )
 */
 {  
     int i, j;
-    double   d_tau;
+    double   d_tau, p, unit = ctx->pher_unit, inv = 1.0 / unit;
 
     d_tau = 1.0 / score;
  
-    for ( i = 0 ; i < n ; i++ ) {
-        j = solutions[i];
-        pheromone[i * 2 + j] += d_tau;
+    for ( i = 0 ; i < ctx->n ; i++ ) {
+        j = GET_GATE( solutions, i );
+        p = PHER_GET( ctx->pheromone[i * 2 + j], unit ) + d_tau;
+        ctx->pheromone[i * 2 + j] = PHER_PUT( p, inv );
     }
 }
 
 
+void fused_pheromone_update( aco_context *ctx, const uint64_t * const *solutions,
+                             const double *d_tau, int n_dep )
+/*    
+      FUNCTION:      evaporation, deposit of up to MAX_ELITE solutions and MMAS
+                     trail limits in a single sweep over the pheromone matrix
+      INPUT:         pointer to the try, packed solutions that deposit pheromone,
+                     the amount each one deposits and their number
+      OUTPUT:        none
+      (SIDE)EFFECTS: same result as evaporation(), global_update_pheromone() of
+                     every solution and check_pheromone_trail_limits() in a row,
+                     followed by compute_choice_table(); the pinned gates and
+                     the branching factor are counted on the way. The inner
+                     loop is branch-free and vectorizes, large instances split
+                     the words among threads. The trails are read in the
+                     previous pher_unit and stored in the one of trail_max;
+                     the choice table is built from the stored values
+*/
+{
+    int       w, e;
+    const int n = ctx->n, n_words = ctx->n_words;
+    pher_real keep, total, lo, hi, lambda, lo_q, dt[MAX_ELITE];
+    double    old_unit, unit, inv;
+    uint64_t  pinned = 0, open = 0;
+
+    keep     = 1 - ctx->rho;
+    lo       = ctx->trail_min;
+    hi       = ctx->trail_max;
+    lambda   = lo + LAMBDA_BRANCHING * (hi - lo);
+    old_unit = ctx->pher_unit;
+    unit     = PHER_UNIT( hi );
+    inv      = 1.0 / unit;
+    lo_q     = PHER_GET( PHER_PUT( lo, inv ), unit );   /* trail_min as stored */
+    for ( total = 0.0, e = 0 ; e < n_dep ; e++ ) {
+        dt[e]  = d_tau[e];
+        total += dt[e];
+    }
+
+    #pragma omp parallel for if ( n >= PAR_UPDATE_MIN_GATES ) schedule(static) reduction(+:pinned, open)
+    for ( w = 0 ; w < n_words ; w++ ) {
+        uint64_t i, m;     /* 64-bit counter: same lane width as the shift, it vectorizes */
+        uint64_t bits[MAX_ELITE], greedy = 0, pin = 0, both = 0;
+        pher_t   *p = &ctx->pheromone[w * WORD_BITS * 2];
+        uint32_t *thr = &ctx->choice_threshold[w * WORD_BITS];
+
+        for ( int d = 0 ; d < n_dep ; d++ )
+            bits[d] = solutions[d][w];
+        m = (n - w * WORD_BITS < WORD_BITS) ? n - w * WORD_BITS : WORD_BITS;
+        #pragma omp simd reduction(|:greedy, pin, both)
+        for ( i = 0 ; i < m ; i++ ) {
+            pher_real d1 = 0.0;   /* deposit on value 1, the rest goes to value 0 */
+            for ( int d = 0 ; d < n_dep ; d++ )
+                d1 += (pher_real) ((bits[d] >> i) & 1) * dt[d];
+            pher_real p0 = keep * (pher_real) PHER_GET( p[i * 2], old_unit )     + (total - d1);
+            pher_real p1 = keep * (pher_real) PHER_GET( p[i * 2 + 1], old_unit ) + d1;
+            p0 = (p0 < lo) ? lo : p0;
+            p0 = (p0 > hi) ? hi : p0;
+            p1 = (p1 < lo) ? lo : p1;
+            p1 = (p1 > hi) ? hi : p1;
+            p[i * 2]     = PHER_PUT( p0, inv );
+            p[i * 2 + 1] = PHER_PUT( p1, inv );
+            p0 = (pher_real) PHER_GET( p[i * 2], unit );
+            p1 = (pher_real) PHER_GET( p[i * 2 + 1], unit );
+            thr[i]  = (uint32_t) fmin( (double) (p0 / (p0 + p1)) * FIXED_ONE, FIXED_ONE - 1 );
+            greedy |= (uint64_t) (p0 <= p1) << i;
+            pin    |= (uint64_t) ((p0 <= lo_q) | (p1 <= lo_q)) << i;
+            both   |= (uint64_t) ((p0 >= lambda) & (p1 >= lambda)) << i;
+        }
+        ctx->greedy_choice[w] = greedy;
+        pinned += __builtin_popcountll( pin );
+        open   += __builtin_popcountll( both );
+    }
+    ctx->pher_unit = unit;
+    ctx->pinned    = (double) pinned / n;
+    ctx->branching = 1.0 + (double) open / n;
+}
+
+
+void compute_choice_table( aco_context *ctx )
+/*    
+      FUNCTION:      refresh the choice table from the pheromone matrix
+      INPUT:         pointer to the try
+      OUTPUT:        none
+      (SIDE)EFFECTS: choice_threshold, greedy_choice and q_0_threshold are updated;
+                     needed after the trails are changed outside
+                     fused_pheromone_update()
+*/
+{
+    int      i;
+    double   p0, p1, unit = ctx->pher_unit;
+
+    memset( ctx->greedy_choice, 0, sizeof( uint64_t ) * ctx->n_words );
+    for ( i = 0 ; i < ctx->n ; i++ ) {
+        p0 = PHER_GET( ctx->pheromone[i * 2], unit );
+        p1 = PHER_GET( ctx->pheromone[i * 2 + 1], unit );
+        ctx->choice_threshold[i] = (uint32_t) fmin( p0 / (p0 + p1) * FIXED_ONE, FIXED_ONE - 1 );
+        if ( p0 <= p1 ) SET_GATE( ctx->greedy_choice, i );
+    }
+    ctx->q_0_threshold = (uint64_t) (ctx->q_0 * FIXED_ONE);
+}
+
+
 /****************************************************************
  ****************************************************************
 Procedures implementing solution construction and related things
@@ -184,43 +396,143 @@ Procedures implementing solution construction and related things
  ****************************************************************/
 
 
-void select_gate( int k, int gate )
+double construct_ant( aco_context *ctx, ant_rng_t *rng, const uint32_t *choice_threshold,
+                      const uint64_t *greedy_choice, uint64_t *solution )
+/*    
+      FUNCTION:      builds one solution, word by word
+      INPUT:         pointer to the try, random stream of the ant, the choice
+                     table to build from and where to store the solution
+      OUTPUT:        score of the solution for a decomposable objective
+                     (evaluate_word), 0 otherwise
+      (SIDE)EFFECT:  one random word is drawn per gate
+*/
+{
+    return construct_words( ctx, rng, choice_threshold, greedy_choice, solution, 0, ctx->n_words );
+}
+
+
+double construct_words( aco_context *ctx, ant_rng_t *rng, const uint32_t *choice_threshold,
+                        const uint64_t *greedy_choice, uint64_t *solution, int w0, int w1 )
+/*    
+      FUNCTION:      builds words w0 .. w1-1 of a solution
+      INPUT:         as construct_ant(), and the range of words
+      OUTPUT:        their part of the score for a decomposable objective
+                     (evaluate_word), 0 otherwise
+      (SIDE)EFFECT:  one random word is drawn per gate
+*/
+{
+    int      w, m;
+    const int n = ctx->n;
+    const aco_objective *obj = ctx->objective;
+    uint64_t rnd[WORD_BITS], word;
+    double   score = 0.0;
+
+    for ( w = w0 ; w < w1 ; w++ ) {
+        m = (n - w * WORD_BITS < WORD_BITS) ? n - w * WORD_BITS : WORD_BITS;
+        rng_fill_bits( rng, rnd, m );
+        word = construct_word( ctx, choice_threshold, greedy_choice, w, rnd );
+        solution[w] = word;
+        if ( obj->evaluate_word ) score += obj->evaluate_word( ctx->obj_state, w, word );
+    }
+    return score;
+}
+
+
+void construct_ant_blocks( aco_context *ctx, int k, int uniform )
+/*    
+      FUNCTION:      builds ant k with all threads, see GATE_BLOCK_WORDS
+      INPUT:         pointer to the try, ant and whether the gates are drawn
+                     uniformly (first iteration) instead of from the choice table
+      OUTPUT:        none
+      (SIDE)EFFECT:  solution and score of ant k are set; the partial scores
+                     are summed in block order, so the score does not depend on
+                     the number of threads either. A uniform ant scores 0
+*/
+{
+    const int n_words = ctx->n_words;
+    uint64_t  *solution = &ctx->ant_solutions[k * n_words], key;
+    double    score = 0.0;
+    int       b;
+
+    rng_fill_bits( &ctx->ant_rng[k], &key, 1 );
+
+    #pragma omp parallel for schedule(dynamic)
+    for ( b = 0 ; b < ctx->n_blocks ; b++ ) {
+        ant_rng_t r;
+        int       w0 = b * GATE_BLOCK_WORDS;
+        int       w1 = (w0 + GATE_BLOCK_WORDS < n_words) ? w0 + GATE_BLOCK_WORDS : n_words;
+
+        rng_seed( &r, key, (uint64_t) b );
+        if ( uniform ) {
+            rng_fill_bits( &r, &solution[w0], w1 - w0 );
+            ctx->block_scores[b * BLOCK_SCORE_STRIDE] = 0.0;
+        }
+        else
+            ctx->block_scores[b * BLOCK_SCORE_STRIDE] =
+                construct_words( ctx, &r, ctx->choice_threshold, ctx->greedy_choice, solution, w0, w1 );
+    }
+
+    if ( uniform && ctx->n % WORD_BITS )
+        solution[n_words - 1] &= ((uint64_t) 1 << (ctx->n % WORD_BITS)) - 1;
+    for ( b = 0 ; b < ctx->n_blocks ; b++ )
+        score += ctx->block_scores[b * BLOCK_SCORE_STRIDE];
+    ctx->ant_scores[k] = score;
+}
+
+
+uint64_t construct_word( aco_context *ctx, const uint32_t *choice_threshold,
+                         const uint64_t *greedy_choice, int w, const uint64_t *rnd )
+/*    
+      FUNCTION:      chooses the gates of word w of a solution
+      INPUT:         pointer to the try, the choice table, index w of the word
+                     and one random word per gate in it
+      OUTPUT:        the packed gates of word w
+      (SIDE)EFFECT:  none; the low 32 bits of each random word pick the gate
+                     by pheromone, the high 32 bits decide whether the greedy
+                     choice (probability q_0) is taken instead. Branch-free,
+                     the loop vectorizes
+*/
+{ 
+    uint64_t i, m, word = 0, greedy = greedy_choice[w];
+    const uint64_t q_0_threshold = ctx->q_0_threshold;
+    const uint32_t *thr = &choice_threshold[w * WORD_BITS];
+
+    m = (ctx->n - w * WORD_BITS < WORD_BITS) ? ctx->n - w * WORD_BITS : WORD_BITS;
+    #pragma omp simd reduction(|:word)
+    for ( i = 0 ; i < m ; i++ ) {
+        uint64_t choice = (uint32_t) rnd[i] >= thr[i];
+        uint64_t best   = (rnd[i] >> 32) < q_0_threshold;
+        uint64_t g      = (greedy >> i) & 1;
+
+        word |= ((best & g) | (~best & choice & 1)) << i;
+    }
+    return word;
+}
+
+
+void select_gate( aco_context *ctx, int k, int gate, uint64_t rnd )
 /*    
       FUNCTION:      chooses for an ant the next gate as the one with
                      maximal value of heuristic information times pheromone 
-      INPUT:         index k of the ant and the construction step
+      INPUT:         pointer to the try, index k of the ant, the construction step
+                     and a random word
       OUTPUT:        none 
-      (SIDE)EFFECT:  ant moves to the next gate
+      (SIDE)EFFECT:  ant moves to the next gate; same rule as construct_word()
 */
 { 
-    double prob, prob0, prob1;
-    prob  = pheromone[gate * 2 /*+ 0*/] + pheromone[gate * 2 + 1];
-    prob0 = pheromone[gate * 2 /*+ 0*/] / prob;
-    prob1 = pheromone[gate * 2   + 1  ] / prob;
+    uint64_t *solution = &ctx->ant_solutions[k * ctx->n_words];
 
-    if ( (q_0 > 0.0) && (ran01( &seed ) < q_0)  ) {
+    if ( (rnd >> 32) < ctx->q_0_threshold ) {
         /* with a probability q_0 make the best possible choice
          according to pheromone trails and heuristic information */
-        /* we first check whether q_0 > 0.0, to avoid the very common case
-         of q_0 = 0.0 to have to compute a random number, which is
-         expensive computationally */
-        if (prob1 < prob0 ) {
-            ant_solutions[k * n + gate] = 0;
-        }
-        else {
-            ant_solutions[k * n + gate] = 1;
-        }
+        if ( GET_GATE( ctx->greedy_choice, gate ) ) SET_GATE( solution, gate );
+        else CLEAR_GATE( solution, gate );
     }
     else {
-        if (ran01(&seed) < prob0 ) {
-            ant_solutions[k * n + gate] = 0;
-        }
-        else {
-            ant_solutions[k * n + gate] = 1;
-        }
+        if ( (uint32_t) rnd < ctx->choice_threshold[gate] ) CLEAR_GATE( solution, gate );
+        else SET_GATE( solution, gate );
     }
-    
- }
+}
 
 
 /**************************************************************************
@@ -231,21 +543,17 @@ Procedures specific to the ant's tour manipulation other than construction
 
 
 
-void copy_from_to(int *solution1, double score1, int *solution2, double *score2) 
+void copy_from_to( aco_context *ctx, uint64_t *solution1, double score1, uint64_t *solution2, double *score2 )
 {
 /*    
       FUNCTION:       copy solution from ant a1 [j] and a2 [k]
-      INPUT:          indices of the two ants a1 [j] and a2 [k]
+      INPUT:          pointer to the try and the two solutions a1 [j] and a2 [k]
       OUTPUT:         none
       (SIDE)EFFECTS:  a2 is copy of a1
 */
-    int   i;
-
-    *score2 = score1; //copying first position
+    *score2 = score1;
 
-    for ( i = 0 ; i < n ; i++ ) { // we can start at index 1 as first position is copied right before
-        solution2[i] = solution1[i]; 
-    }
+    memcpy( solution2, solution1, sizeof( uint64_t ) * ctx->n_words );
 }
 
 
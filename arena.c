@@ -0,0 +1,133 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file arena.c
+ * @brief File contains the arena of the colony buffers: one anonymous
+ *        mapping per thread running tries, optionally backed by huge pages,
+ *        from which every try carves its cache-line aligned buffers
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "aco.h"
+
+
+void init_arena( aco_arena *a, int huge_pages )
+/*
+      FUNCTION:       set up an empty arena
+      INPUT:          pointer to the arena and kind of pages (see aco_params)
+      OUTPUT:         none
+      (SIDE)EFFECTS:  nothing is mapped until the first arena_reset()
+*/
+{
+    a->base       = NULL;
+    a->size       = 0;
+    a->used       = 0;
+    a->huge_pages = huge_pages;
+}
+
+
+static char *map_arena( aco_arena *a, size_t size )
+/*
+      FUNCTION:       map the memory of an arena
+      INPUT:          pointer to the arena and size, a multiple of HUGE_PAGE_SIZE
+      OUTPUT:         start of the mapping
+      (SIDE)EFFECTS:  without free explicit huge pages (hugetlbfs), the arena
+                      falls back to transparent ones for the rest of the run
+*/
+{
+    void *m;
+
+    if ( a->huge_pages == 2 ) {
+        m = mmap( NULL, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if ( m != MAP_FAILED ) return (char *) m;
+        printf("No explicit huge pages for %zu bytes, using transparent ones\n", size);
+        a->huge_pages = 1;
+    }
+
+    m = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( m == MAP_FAILED ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+#ifdef MADV_HUGEPAGE
+    if ( a->huge_pages == 1 ) madvise( m, size, MADV_HUGEPAGE );
+#endif
+    return (char *) m;
+}
+
+
+void arena_reset( aco_arena *a, size_t size )
+/*
+      FUNCTION:       make room for the buffers of a new try
+      INPUT:          pointer to the arena and bytes needed, including the
+                      alignment of every block
+      OUTPUT:         none
+      (SIDE)EFFECTS:  all blocks of the previous try are released; the mapping
+                      is only replaced when it is too small, so tries of the
+                      same size run on pages that are already resident
+*/
+{
+    if ( size > a->size ) {
+        if ( a->base ) munmap( a->base, a->size );
+        a->size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        a->base = map_arena( a, a->size );
+    }
+    a->used = 0;
+}
+
+
+void * arena_alloc( aco_arena *a, size_t size )
+/*
+      FUNCTION:       take a block from the arena
+      INPUT:          pointer to the arena and size of the block
+      OUTPUT:         pointer to the block, aligned to CACHE_LINE
+      (SIDE)EFFECTS:  the block is not cleared: it holds whatever the previous
+                      try left, or zeros on freshly mapped pages
+*/
+{
+    char *p;
+
+    size = (size + CACHE_LINE - 1) & ~((size_t) CACHE_LINE - 1);
+    if ( a->used + size > a->size ) {
+        printf("Arena of %zu bytes exhausted, exit.", a->size);
+        exit(1);
+    }
+    p = a->base + a->used;
+    a->used += size;
+    return p;
+}
+
+
+void exit_arena( aco_arena *a )
+/*
+      FUNCTION:       release the memory of an arena
+      INPUT:          pointer to the arena
+      OUTPUT:         none
+*/
+{
+    if ( a->base ) munmap( a->base, a->size );
+    a->base = NULL;
+    a->size = a->used = 0;
+}
+
+
+void print_resource_usage( void )
+/*
+      FUNCTION:       print the memory use of the process
+      INPUT:          none
+      OUTPUT:         none
+      (SIDE)EFFECTS:  peak resident set and page faults, read by the scaling
+                      harness, see scaling.sh
+*/
+{
+    struct rusage usage;
+
+    getrusage( RUSAGE_SELF, &usage );
+    printf("peak_rss_kb %ld\n", usage.ru_maxrss);
+    printf("page_faults %ld minor %ld major\n", usage.ru_minflt, usage.ru_majflt);
+}
@@ -0,0 +1,263 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file async.c
+ * @brief File contains the steady-state colony: ants are built and evaluated
+ *        continuously against a recent choice table, and the pheromone update
+ *        of a colony overlaps with the construction of the next one
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "aco.h"
+
+
+static int acquire_table( async_state *a )
+/*
+      FUNCTION:       pick the choice table to build an ant from
+      INPUT:          pointer to the steady-state colony
+      OUTPUT:         index of the front buffer
+      (SIDE)EFFECTS:  the worker is counted as a reader of the buffer until
+                      release_table(); a buffer that stopped being the front
+                      before the worker was counted is not used
+*/
+{
+    int b;
+
+    for ( ; ; ) {
+        b = atomic_load( &a->front );
+        atomic_fetch_add( &a->readers[b], 1 );
+        if ( atomic_load( &a->front ) == b )
+            return b;
+        atomic_fetch_sub( &a->readers[b], 1 );
+    }
+}
+
+
+static void release_table( async_state *a, int b )
+{
+    atomic_fetch_sub( &a->readers[b], 1 );
+}
+
+
+static void update_colony( aco_context *ctx )
+/*
+      FUNCTION:       one iteration of the algorithm on a full colony
+      INPUT:          pointer to the try, whose colony is the one just filled
+      OUTPUT:         none
+      (SIDE)EFFECTS:  same steps as an iteration of aco_algorithm(); the new
+                      choice table is written to the back buffer, once no
+                      worker reads it, and becomes the front
+*/
+{
+    async_state *a = ctx->async;
+    int         back = 1 - atomic_load( &a->front );
+
+    PHASE_BEGIN( ctx );
+
+    if ( ctx->ls_ants ) {
+        local_search( ctx );
+        PHASE_END( ctx, PH_LOCAL );
+    }
+
+    update_statistics( ctx );
+    PHASE_END( ctx, PH_STATISTICS );
+
+    if ( ctx->migration && ctx->iteration % ctx->migration_interval == 0 ) {
+        migrate( ctx );
+        PHASE_END( ctx, PH_MIGRATE );
+    }
+
+    while ( atomic_load( &a->readers[back] ) )
+        sched_yield();
+    ctx->choice_threshold = a->threshold[back];
+    ctx->greedy_choice    = a->greedy[back];
+    pheromone_trail_update( ctx );
+    atomic_store( &a->front, back );
+    PHASE_END( ctx, PH_PHEROMONE );
+
+    ctx->iteration++;
+
+    if ( checkpoint_due( ctx ) ) save_checkpoint( ctx, 0, 0 );
+    if ( run_stopped() ) ctx->stopped = 1;
+    if ( ctx->stopped || termination_condition( ctx ) )
+        atomic_store( &a->done, 1 );
+}
+
+
+static int submit_ant( aco_context *ctx, const uint64_t *solution, uint64_t hash, double score,
+                       int evaluated )
+/*
+      FUNCTION:       add an ant to the colony being filled
+      INPUT:          pointer to the try, solution, its hash (cache only), score
+                      and whether it was evaluated (rather than found in the cache)
+      OUTPUT:         1 if the ant completed the colony: the caller is then the
+                      updater of that colony, which is the colony of the try
+      (SIDE)EFFECTS:  a completed colony is only handed over once the previous
+                      updater has finished; until then the lock is released
+                      (cache lookups go on) and further ants wait for the
+                      hand-over, since both colonies are in use
+*/
+{
+    async_state *a = ctx->async;
+    const int   n_words = ctx->n_words;
+    int         k, full = 0;
+
+    pthread_mutex_lock( &a->lock );
+    if ( evaluated && ctx->cache )
+        cache_insert( ctx->cache, solution, hash, score );
+
+    while ( a->count == ctx->n_ants )
+        pthread_cond_wait( &a->changed, &a->lock );
+    k = a->count++;
+    memcpy( &a->solutions[a->filling][k * n_words], solution, sizeof( uint64_t ) * n_words );
+    a->scores[a->filling][k] = score;
+    top_insert( &a->top, ctx->top_k, k, score );
+
+    if ( a->count == ctx->n_ants ) {
+        while ( a->updating )
+            pthread_cond_wait( &a->changed, &a->lock );
+        a->updating = 1;
+        ctx->ant_solutions = a->solutions[a->filling];
+        ctx->ant_scores    = a->scores[a->filling];
+        ctx->top           = a->top;
+        a->filling ^= 1;
+        a->count    = 0;
+        a->top.n    = 0;
+        full        = 1;
+        pthread_cond_broadcast( &a->changed );
+    }
+    pthread_mutex_unlock( &a->lock );
+    return full;
+}
+
+
+static void worker( aco_context *ctx, int t )
+/*
+      FUNCTION:       build, evaluate and submit ants until the try ends
+      INPUT:          pointer to the try and worker index
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the worker that completes a colony runs its update and
+                      then goes back to building ants
+*/
+{
+    async_state         *a = ctx->async;
+    const aco_objective *obj = ctx->objective;
+    uint64_t            *solution = &a->scratch[t * ctx->n_words], hash = 0;
+    double              score;
+    int                 b, found;
+
+    while ( !atomic_load( &a->done ) ) {
+        b = acquire_table( a );
+        score = construct_ant( ctx, &a->rng[t], a->threshold[b], a->greedy[b], solution );
+        release_table( a, b );
+
+        found = 0;
+        if ( !obj->evaluate_word ) {
+            if ( ctx->cache ) {
+                hash = hash_solution( solution, ctx->n_words );
+                pthread_mutex_lock( &a->lock );
+                found = cache_lookup( ctx->cache, solution, hash, &score );
+                pthread_mutex_unlock( &a->lock );
+            }
+            if ( !found )
+                obj->evaluate_batch( ctx->obj_state, solution, 1, &score );
+        }
+
+        if ( submit_ant( ctx, solution, hash, score, !found ) ) {
+            /* a colony completed after the end of the try is dropped */
+            if ( !atomic_load( &a->done ) )
+                update_colony( ctx );
+            pthread_mutex_lock( &a->lock );
+            a->updating = 0;
+            pthread_cond_broadcast( &a->changed );
+            pthread_mutex_unlock( &a->lock );
+        }
+    }
+}
+
+
+void run_async_colony( aco_context *ctx )
+/*
+      FUNCTION:       run the iterations of a try with the steady-state colony
+      INPUT:          pointer to the try, after init_aco()
+      OUTPUT:         none
+      (SIDE)EFFECTS:  replaces the loop of aco_algorithm() when async_colony is set;
+                      an iteration is a colony of n_ants ants, built from the
+                      choice table published by the previous update or the
+                      one before. Every thread of the team is a worker, each
+                      with its own random stream, so a try is not reproducible.
+                      Only the update phases are timed; an incomplete colony
+                      is discarded when the try ends
+*/
+{
+    async_state a;
+    uint32_t    *threshold = ctx->choice_threshold;
+    uint64_t    *greedy = ctx->greedy_choice, *solutions = ctx->ant_solutions;
+    double      *scores = ctx->ant_scores;
+    int         t;
+
+#ifdef _OPENMP
+    a.n_workers = omp_get_max_threads();
+#else
+    a.n_workers = 1;
+#endif
+    if((a.threshold[1] = (uint32_t*) malloc(sizeof( uint32_t ) * ctx->n)) == NULL ||
+       (a.greedy[1] = (uint64_t*) malloc(sizeof( uint64_t ) * ctx->n_words)) == NULL ||
+       (a.solutions[1] = (uint64_t*) malloc(sizeof( uint64_t ) * ctx->n_ants * ctx->n_words)) == NULL ||
+       (a.scores[1] = (double*) malloc(sizeof( double ) * ctx->n_ants)) == NULL ||
+       (a.scratch = (uint64_t*) malloc(sizeof( uint64_t ) * a.n_workers * ctx->n_words)) == NULL ||
+       (a.rng = (ant_rng_t*) aligned_alloc(CACHE_LINE, sizeof( ant_rng_t ) * a.n_workers)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    /* the table of init_aco() (or of the checkpoint) is the first front */
+    a.threshold[0] = threshold;
+    a.greedy[0]    = greedy;
+    a.solutions[0] = solutions;
+    a.scores[0]    = scores;
+    atomic_init( &a.front, 0 );
+    atomic_init( &a.readers[0], 0 );
+    atomic_init( &a.readers[1], 0 );
+    a.updating = 0;
+    atomic_init( &a.done, termination_condition( ctx ) );
+    pthread_mutex_init( &a.lock, NULL );
+    pthread_cond_init( &a.changed, NULL );
+    a.filling = 0;
+    a.count   = 0;
+    a.top.n   = 0;
+    /* streams of the workers follow those of the ants */
+    for ( t = 0 ; t < a.n_workers ; t++ )
+        rng_seed( &a.rng[t], (uint64_t) ctx->seed,
+                  ((uint64_t) ctx->ntry << 48) | ((uint64_t) ctx->island << 32) |
+                  (uint64_t) (ctx->n_ants + t) );
+    ctx->async = &a;
+
+    #pragma omp parallel num_threads( a.n_workers )
+    {
+#ifdef _OPENMP
+        worker( ctx, omp_get_thread_num() );
+#else
+        worker( ctx, 0 );
+#endif
+    }
+
+    ctx->async            = NULL;
+    ctx->choice_threshold = threshold;
+    ctx->greedy_choice    = greedy;
+    ctx->ant_solutions    = solutions;
+    ctx->ant_scores       = scores;
+    pthread_mutex_destroy( &a.lock );
+    pthread_cond_destroy( &a.changed );
+    free( a.threshold[1] );
+    free( a.greedy[1] );
+    free( a.solutions[1] );
+    free( a.scores[1] );
+    free( a.scratch );
+    free( a.rng );
+}
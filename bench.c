@@ -0,0 +1,231 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file bench.c
+ * @brief Microbenchmarks of the ACO kernels on synthetic instances, written
+ *        as CSV and optionally compared with a stored baseline
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aco.h"
+
+#define BENCH_WARMUP      3      /* untimed calls before measuring */
+#define BENCH_BATCHES     5      /* timed batches, the fastest one is kept */
+#define BENCH_MIN_NS      4000000ull  /* minimum length of a batch */
+#define MAX_BASELINE      4096
+
+static const int bench_n[]      = { 4, 66, 579, 1116, 4155, 16384, 65536 };
+static const int bench_n_ants[] = { 16, 100, 256 };
+
+/* rows of the baseline, if any */
+static struct {
+    char   kernel[32];
+    int    n, n_ants;
+    double ns_per_unit;
+} baseline[MAX_BASELINE];
+static int n_baseline = 0;
+
+static volatile double sink;     /* keeps results of pure kernels alive */
+
+typedef void (*kernel_fn)( aco_context *ctx );
+
+
+static void read_baseline( const char *name )
+/*
+ FUNCTION:       load a CSV written by a previous run
+ INPUT:          file name
+ OUTPUT:         none
+ COMMENTS:       a missing file just disables the comparison
+ */
+{
+    FILE *f;
+    char line[LINE_BUF_LEN];
+    char unit[16];
+
+    if ((f = fopen(name, "r")) == NULL) return;
+    while (fgets(line, sizeof( line ), f) && n_baseline < MAX_BASELINE)
+        if (sscanf(line, "%31[^,],%d,%d,%15[^,],%*d,%*f,%lf", baseline[n_baseline].kernel,
+                   &baseline[n_baseline].n, &baseline[n_baseline].n_ants, unit,
+                   &baseline[n_baseline].ns_per_unit) == 5)
+            n_baseline++;
+    fclose(f);
+}
+
+
+static double baseline_speedup( const char *kernel, int n, int n_ants, double ns_per_unit )
+/*
+ FUNCTION:       compare a measurement with the baseline
+ INPUT:          kernel, size, number of ants and measured ns per unit
+ OUTPUT:         baseline time / measured time, 0 if there is no baseline row
+ */
+{
+    int i;
+
+    for (i = 0; i < n_baseline; i++)
+        if (baseline[i].n == n && baseline[i].n_ants == n_ants && !strcmp(baseline[i].kernel, kernel))
+            return baseline[i].ns_per_unit / ns_per_unit;
+    return 0.0;
+}
+
+
+static void measure( FILE *out, const char *kernel, const char *unit, double units,
+                     kernel_fn fn, aco_context *ctx )
+/*
+ FUNCTION:       time a kernel and write its CSV row
+ INPUT:          output file, kernel and unit names, units of work per call,
+                 the kernel and the context it runs on
+ OUTPUT:         none
+ COMMENTS:       the call count of a batch doubles until the batch lasts
+                 BENCH_MIN_NS; the fastest of BENCH_BATCHES batches is kept
+ */
+{
+    long     calls = 1, c;
+    int      b;
+    uint64_t t0, t, best = UINT64_MAX;
+    double   ns_per_call, ns_per_unit, speedup;
+
+    for (b = 0; b < BENCH_WARMUP; b++) fn( ctx );
+
+    do {
+        t0 = monotonic_ns();
+        for (c = 0; c < calls; c++) fn( ctx );
+        t = monotonic_ns() - t0;
+        if (t < BENCH_MIN_NS) calls *= 2;
+    } while (t < BENCH_MIN_NS);
+
+    for (b = 0; b < BENCH_BATCHES; b++) {
+        t0 = monotonic_ns();
+        for (c = 0; c < calls; c++) fn( ctx );
+        t = monotonic_ns() - t0;
+        if (t < best) best = t;
+    }
+
+    ns_per_call = (double) best / calls;
+    ns_per_unit = ns_per_call / units;
+    fprintf(out, "%s,%d,%d,%s,%ld,%f,%f,%f", kernel, ctx->n, ctx->n_ants, unit,
+            calls, ns_per_call, ns_per_unit, 1e9 / ns_per_unit);
+    if ((speedup = baseline_speedup( kernel, ctx->n, ctx->n_ants, ns_per_unit )) > 0.0)
+        fprintf(out, ",%f", speedup);
+    fprintf(out, "\n");
+    fflush(out);
+}
+
+
+/* the kernels, wrapped to a common signature */
+
+static long ran01_seed = 12345;
+
+static void k_ran01( aco_context *ctx ) { sink = ran01( &ran01_seed ); }
+
+static void k_select_gate( aco_context *ctx )
+{
+    int i;
+    for (i = 0; i < ctx->n; i++) select_gate( ctx, 0, i, (uint64_t) i * 0x9E3779B97F4A7C15ull );
+}
+
+static void k_construct( aco_context *ctx ) { construct_solutions( ctx ); }
+
+static void k_obj_function( aco_context *ctx ) { sink = obj_function( ctx->obj_state, ctx->ant_solutions ); }
+
+static void k_evaporation( aco_context *ctx ) { evaporation( ctx ); }
+
+static void k_global_update( aco_context *ctx ) { global_update_pheromone( ctx, ctx->ant_solutions, 1.0 ); }
+
+static void k_trail_limits( aco_context *ctx ) { check_pheromone_trail_limits( ctx ); }
+
+static void k_fused_update( aco_context *ctx )
+{
+    const uint64_t *solution = ctx->ant_solutions;
+    double         d_tau = 1.0;
+
+    fused_pheromone_update( ctx, &solution, &d_tau, 1 );
+}
+
+static void k_choice_table( aco_context *ctx ) { compute_choice_table( ctx ); }
+
+static void k_rank_colony( aco_context *ctx ) { rank_colony( ctx ); }
+
+
+int main( int argc, char *argv[] )
+/*
+ FUNCTION:       run the kernel sweep
+ INPUT:          optional CSV output file (default stdout) and baseline CSV
+ OUTPUT:         0
+ */
+{
+    FILE         *out = stdout;
+    aco_params   params;
+    aco_instance inst;
+    aco_context  *ctx;
+    aco_arena    arena;
+    int          i, j, w;
+    long         seed = 4711;
+
+    if (argc > 1 && (out = fopen(argv[1], "w")) == NULL) {
+        printf("Cannot write %s, exit.", argv[1]);
+        exit(1);
+    }
+    if (argc > 2) read_baseline( argv[2] );
+
+    if((ctx = (aco_context*) aligned_alloc(CACHE_LINE, sizeof( aco_context ))) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    set_default_parameters( &params );
+    params.seed = seed;
+    init_arena( &arena, params.huge_pages );
+
+    fprintf(out, "kernel,n,n_ants,unit,calls,ns_per_call,ns_per_unit,units_per_s%s\n",
+            n_baseline ? ",speedup" : "");
+
+    for (i = 0; i < (int) (sizeof( bench_n ) / sizeof( int )); i++) {
+        /* random optimum, so that the scores are not trivial */
+        inst.n       = bench_n[i];
+        inst.n_words = N_WORDS( inst.n );
+        inst.map     = NULL;
+        if((inst.bs_optimum = (uint64_t*) calloc(inst.n_words, sizeof( uint64_t ))) == NULL){
+            printf("Out of memory, exit.");
+            exit(1);
+        }
+        for (w = 0; w < inst.n; w++)
+            if (ran01( &seed ) < 0.5) SET_GATE( inst.bs_optimum, w );
+        inst.objective = &toymodel_objective;
+        inst.obj_state = inst.objective->init( &inst );
+
+        for (j = 0; j < (int) (sizeof( bench_n_ants ) / sizeof( int )); j++) {
+            params.n_ants = bench_n_ants[j];
+            init_context( ctx, &params, &inst, NULL, &arena, 0 );
+            init_aco( ctx );
+            init_ants( ctx );
+
+            if (i == 0 && j == 0)
+                measure( out, "ran01", "draw", 1, k_ran01, ctx );
+            measure( out, "select_gate", "gate", ctx->n, k_select_gate, ctx );
+            measure( out, "construct_solutions", "gate", (double) ctx->n * ctx->n_ants, k_construct, ctx );
+            measure( out, "obj_function", "gate", ctx->n, k_obj_function, ctx );
+            measure( out, "rank_colony", "ant", ctx->n_ants, k_rank_colony, ctx );
+            measure( out, "compute_choice_table", "gate", ctx->n, k_choice_table, ctx );
+
+            /* with rho = 0 the repeated evaporation cannot drive the trails
+               into denormals, which would time a different code path */
+            ctx->rho = 0.0;
+            measure( out, "evaporation", "gate", ctx->n, k_evaporation, ctx );
+            measure( out, "global_update_pheromone", "gate", ctx->n, k_global_update, ctx );
+            measure( out, "check_pheromone_trail_limits", "gate", ctx->n, k_trail_limits, ctx );
+            measure( out, "fused_pheromone_update", "gate", ctx->n, k_fused_update, ctx );
+
+            exit_aco( ctx );
+        }
+        inst.objective->teardown( inst.obj_state );
+        exit_benchmark( &inst );
+    }
+
+    exit_arena( &arena );
+    free( ctx );
+    if (out != stdout) fclose( out );
+    return (0);
+}
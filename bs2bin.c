@@ -0,0 +1,48 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file bs2bin.c
+ * @brief Converts a text benchmark into the binary (mappable) format
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "aco.h"
+
+
+int main( int argc, char *argv[] )
+/*
+ FUNCTION:       convert a benchmark file; the output is read back and compared
+ INPUT:          input and output file names
+ OUTPUT:         0 on success
+ */
+{
+    aco_instance in, out;
+    int w;
+
+    if (argc != 3) {
+        printf("Usage: %s <benchmark.bs> <benchmark.bin>\n", argv[0]);
+        exit(1);
+    }
+
+    read_benchmark (argv[1], &in);
+    write_benchmark_binary (argv[2], &in);
+
+    read_benchmark (argv[2], &out);
+    if (out.n != in.n) {
+        printf("Conversion failed, exit.");
+        exit(1);
+    }
+    for (w = 0; w < in.n_words; w++)
+        if (out.bs_optimum[w] != in.bs_optimum[w]) {
+            printf("Conversion failed, exit.");
+            exit(1);
+        }
+    printf("%s: %d gates\n", argv[2], in.n);
+
+    exit_benchmark( &out );
+    exit_benchmark( &in );
+    return (0);
+}
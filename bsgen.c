@@ -0,0 +1,90 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file bsgen.c
+ * @brief Generates toy-model instances of any size from a fixed seed
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aco.h"
+
+
+static void write_benchmark_text( char *bench_file_name, const aco_instance *inst )
+/*
+ FUNCTION:       write an instance in the text format of benchmarks/
+ INPUT:          file name and pointer to the instance
+ OUTPUT:         none
+ */
+{
+    FILE *out;
+    int  i;
+
+    if ((out = fopen(bench_file_name, "w")) == NULL) {
+        printf("Cannot write benchmark file %s, abort\n", bench_file_name);
+        exit(1);
+    }
+    fprintf(out, "%d ", inst->n);
+    for (i = 0; i < inst->n; i++)
+        fputs(GET_GATE( inst->bs_optimum, i ) ? "1 " : "0 ", out);
+    fprintf(out, "\n");
+    fclose(out);
+}
+
+
+int main( int argc, char *argv[] )
+/*
+ FUNCTION:       generate an instance: the optimum is drawn gate by gate, each
+                 gate being 1 with the given density
+ INPUT:          number of gates, seed, output file (text if it ends in .bs,
+                 binary otherwise) and optional density (default 0.5)
+ OUTPUT:         0 on success
+ COMMENTS:       the same n, seed and density always give the same instance
+ */
+{
+    aco_instance inst;
+    ant_rng_t    rng;
+    double       density = 0.5, rnd[WORD_BITS];
+    long         n;
+    size_t       len;
+    int          w, b, m;
+
+    if (argc < 4 || argc > 5) {
+        printf("Usage: %s <n> <seed> <benchmark.bs|benchmark.bin> [density]\n", argv[0]);
+        exit(1);
+    }
+    n = atol(argv[1]);
+    if (argc == 5) density = atof(argv[4]);
+    if (n < 1 || n > MAX_GATES || density < 0.0 || density > 1.0) {
+        printf("Invalid size or density, exit.");
+        exit(1);
+    }
+
+    inst.n       = (int) n;
+    inst.n_words = N_WORDS( inst.n );
+    inst.map     = NULL;
+    if((inst.bs_optimum = (uint64_t*) calloc(inst.n_words, sizeof( uint64_t ))) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+
+    rng_seed( &rng, (uint64_t) atol(argv[2]), 0 );
+    for (w = 0; w < inst.n_words; w++) {
+        m = (inst.n - w * WORD_BITS < WORD_BITS) ? inst.n - w * WORD_BITS : WORD_BITS;
+        rng_fill_01( &rng, rnd, m );
+        for (b = 0; b < m; b++)
+            if (rnd[b] < density) inst.bs_optimum[w] |= (uint64_t) 1 << b;
+    }
+
+    len = strlen(argv[3]);
+    if (len > 3 && !strcmp(argv[3] + len - 3, ".bs"))
+        write_benchmark_text( argv[3], &inst );
+    else
+        write_benchmark_binary( argv[3], &inst );
+
+    exit_benchmark( &inst );
+    return (0);
+}
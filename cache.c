@@ -0,0 +1,205 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file cache.c
+ * @brief File contains the score cache, which lets the colony skip the
+ *        objective for solutions that were already evaluated
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aco.h"
+
+
+score_cache * init_cache( int entries, int n_words, int n_ants, int verify )
+/*
+      FUNCTION:       allocate an empty score cache
+      INPUT:          number of entries (rounded up to whole sets), words per
+                      solution, number of ants and whether to store full solutions
+      OUTPUT:         pointer to the cache
+      (SIDE)EFFECTS:  all memory is allocated here, the cache never grows
+*/
+{
+    score_cache *c;
+    int         size;
+
+    if((c = (score_cache*) calloc(1, sizeof( score_cache ))) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    c->n_sets  = (entries + CACHE_WAYS - 1) / CACHE_WAYS;
+    c->n_words = verify ? n_words : 0;
+    size = c->n_sets * CACHE_WAYS;
+
+    if((c->hashes = (uint64_t*) malloc(sizeof( uint64_t ) * size)) == NULL ||
+       (c->scores = (double*) malloc(sizeof( double ) * size)) == NULL ||
+       (c->state = (uint8_t*) calloc(size, sizeof( uint8_t ))) == NULL ||
+       (c->hands = (uint8_t*) calloc(c->n_sets, sizeof( uint8_t ))) == NULL ||
+       (c->batch = (uint64_t*) malloc(sizeof( uint64_t ) * n_ants * n_words)) == NULL ||
+       (c->batch_hashes = (uint64_t*) malloc(sizeof( uint64_t ) * n_ants)) == NULL ||
+       (c->batch_scores = (double*) malloc(sizeof( double ) * n_ants)) == NULL ||
+       (c->ant_batch = (int*) malloc(sizeof( int ) * n_ants)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    if ( verify && (c->keys = (uint64_t*) malloc(sizeof( uint64_t ) * size * n_words)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    return c;
+}
+
+
+void exit_cache( score_cache *c )
+/*
+      FUNCTION:       release a score cache
+      INPUT:          pointer to the cache
+      OUTPUT:         none
+      (SIDE)EFFECTS:  none
+*/
+{
+    free( c->hashes );
+    free( c->scores );
+    free( c->state );
+    free( c->hands );
+    free( c->keys );
+    free( c->batch );
+    free( c->batch_hashes );
+    free( c->batch_scores );
+    free( c->ant_batch );
+    free( c );
+}
+
+
+uint64_t hash_solution( const uint64_t *solution, int n_words )
+/*
+      FUNCTION:       64-bit hash of a packed solution
+      INPUT:          the solution and its number of words
+      OUTPUT:         hash value
+      (SIDE)EFFECTS:  none
+*/
+{
+    int      i;
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+
+    for ( i = 0 ; i < n_words ; i++ ) {
+        h = (h ^ solution[i]) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+
+int cache_lookup( score_cache *c, const uint64_t *solution, uint64_t hash, double *score )
+/*
+      FUNCTION:       look up the score of a solution
+      INPUT:          pointer to the cache, the solution, its hash and where to
+                      store the score
+      OUTPUT:         1 if found (and *score is set), 0 otherwise
+      (SIDE)EFFECTS:  a found entry is marked as referenced; counters are updated
+*/
+{
+    int  i, e, set = (int) (hash % c->n_sets);
+
+    for ( i = 0 ; i < CACHE_WAYS ; i++ ) {
+        e = set * CACHE_WAYS + i;
+        if ( c->state[e] && c->hashes[e] == hash &&
+             (!c->keys || !memcmp( &c->keys[(size_t) e * c->n_words], solution,
+                                   sizeof( uint64_t ) * c->n_words )) ) {
+            c->state[e] = 2;
+            *score = c->scores[e];
+            c->hits++;
+            return 1;
+        }
+    }
+    c->misses++;
+    return 0;
+}
+
+
+void cache_insert( score_cache *c, const uint64_t *solution, uint64_t hash, double score )
+/*
+      FUNCTION:       store the score of a solution
+      INPUT:          pointer to the cache, the solution, its hash and its score
+      OUTPUT:         none
+      (SIDE)EFFECTS:  an entry of the same solution is updated in place;
+                      otherwise an empty way of the set is used if there is
+                      one, or else the clock hand of the set skips (and clears)
+                      referenced entries and evicts the first one that is not
+*/
+{
+    int  i, e = -1, set = (int) (hash % c->n_sets);
+
+    for ( i = set * CACHE_WAYS ; i < (set + 1) * CACHE_WAYS ; i++ ) {
+        if ( c->state[i] && c->hashes[i] == hash &&
+             (!c->keys || !memcmp( &c->keys[(size_t) i * c->n_words], solution,
+                                   sizeof( uint64_t ) * c->n_words )) ) {
+            c->scores[i] = score;
+            return;
+        }
+    }
+    for ( i = 0 ; i < CACHE_WAYS && e < 0 ; i++ ) {
+        if ( !c->state[set * CACHE_WAYS + i] ) e = set * CACHE_WAYS + i;
+    }
+    while ( e < 0 ) {
+        i = set * CACHE_WAYS + c->hands[set];
+        c->hands[set] = (c->hands[set] + 1) % CACHE_WAYS;
+        if ( c->state[i] == 2 ) c->state[i] = 1;
+        else e = i;
+    }
+
+    c->state[e]  = 1;
+    c->hashes[e] = hash;
+    c->scores[e] = score;
+    if ( c->keys )
+        memcpy( &c->keys[(size_t) e * c->n_words], solution, sizeof( uint64_t ) * c->n_words );
+}
+
+
+void evaluate_colony( aco_context *ctx )
+/*
+      FUNCTION:       score all ants of the colony with the batch objective
+      INPUT:          pointer to the try
+      OUTPUT:         none
+      (SIDE)EFFECTS:  ant_scores is filled; with a cache, only the distinct
+                      solutions not found in it are gathered and sent to the
+                      objective, and their scores are stored afterwards. Ants
+                      that built the same solution share one evaluation
+*/
+{
+    score_cache *c = ctx->cache;
+    const int   n_words = ctx->n_words;
+    int         k, b, n_batch = 0;
+    uint64_t    *solution, hash;
+
+    if ( !c ) {
+        ctx->objective->evaluate_batch( ctx->obj_state, ctx->ant_solutions, ctx->n_ants, ctx->ant_scores );
+        return;
+    }
+
+    for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+        solution = &ctx->ant_solutions[k * n_words];
+        hash = hash_solution( solution, n_words );
+        c->ant_batch[k] = -1;
+        if ( cache_lookup( c, solution, hash, &ctx->ant_scores[k] ) ) continue;
+        for ( b = 0 ; b < n_batch ; b++ ) {
+            if ( c->batch_hashes[b] == hash &&
+                 !memcmp( &c->batch[b * n_words], solution, sizeof( uint64_t ) * n_words ) ) break;
+        }
+        if ( b == n_batch ) {
+            memcpy( &c->batch[n_batch * n_words], solution, sizeof( uint64_t ) * n_words );
+            c->batch_hashes[n_batch++] = hash;
+        }
+        c->ant_batch[k] = b;
+    }
+
+    if ( n_batch == 0 ) return;
+    ctx->objective->evaluate_batch( ctx->obj_state, c->batch, n_batch, c->batch_scores );
+
+    for ( k = 0 ; k < ctx->n_ants ; k++ ) {
+        if ( c->ant_batch[k] >= 0 ) ctx->ant_scores[k] = c->batch_scores[c->ant_batch[k]];
+    }
+    for ( b = 0 ; b < n_batch ; b++ )
+        cache_insert( c, &c->batch[b * n_words], c->batch_hashes[b], c->batch_scores[b] );
+}
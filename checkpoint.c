@@ -0,0 +1,261 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file checkpoint.c
+ * @brief File contains checkpoint and resume of the tries: the state is
+ *        copied to a buffer at an iteration boundary and written to disk by
+ *        a background thread, so the colony does not wait for the file system
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "aco.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+static volatile sig_atomic_t checkpoint_requests = 0;
+
+
+static void on_signal( int sig )
+/*
+      FUNCTION:       signal handler
+      INPUT:          signal number
+      OUTPUT:         none
+      (SIDE)EFFECTS:  SIGTERM stops the run after a checkpoint, SIGUSR1 asks
+                      every running try for a checkpoint
+*/
+{
+    if ( sig == SIGTERM ) stop_requested = 1;
+    else checkpoint_requests++;
+}
+
+
+void init_signals( const aco_params *p )
+/*
+      FUNCTION:       install the checkpoint signal handlers
+      INPUT:          pointer to the parameter settings
+      OUTPUT:         none
+      (SIDE)EFFECTS:  only with checkpoint_interval >= 0, otherwise SIGTERM
+                      keeps its default action
+*/
+{
+    struct sigaction sa;
+
+    if ( p->checkpoint_interval < 0 ) return;
+    memset( &sa, 0, sizeof( sa ) );
+    sa.sa_handler = on_signal;
+    sigemptyset( &sa.sa_mask );
+    sa.sa_flags = SA_RESTART;
+    sigaction( SIGTERM, &sa, NULL );
+    sigaction( SIGUSR1, &sa, NULL );
+}
+
+
+int run_stopped( void )
+/*
+      FUNCTION:       whether SIGTERM was received
+      INPUT:          none
+      OUTPUT:         1 if the tries have to stop
+      (SIDE)EFFECTS:  none
+*/
+{
+    return stop_requested;
+}
+
+
+int checkpoint_due( aco_context *ctx )
+/*
+      FUNCTION:       whether the try has to write a checkpoint now
+      INPUT:          pointer to the try
+      OUTPUT:         1 on a new SIGUSR1 or once checkpoint_interval seconds
+                      passed since the last checkpoint
+      (SIDE)EFFECTS:  the request is marked as handled; like max_time, the
+                      clock is only read every DEADLINE_CHECK iterations
+*/
+{
+    unsigned requests = checkpoint_requests;
+
+    if ( ctx->checkpoint_interval < 0 ) return 0;
+    if ( requests != ctx->checkpoint_seen ) {
+        ctx->checkpoint_seen = requests;
+        return 1;
+    }
+    return ctx->checkpoint_interval > 0 && ctx->iteration % DEADLINE_CHECK == 0 &&
+           elapsed_time( ctx, REAL ) >= ctx->last_checkpoint + ctx->checkpoint_interval;
+}
+
+
+static void *checkpoint_writer( void *arg )
+/*
+      FUNCTION:       write a snapshot to disk
+      INPUT:          pointer to the try
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the snapshot goes to a temporary file that is renamed
+                      over the checkpoint, so a crash never leaves a torn one
+*/
+{
+    aco_context *ctx = (aco_context *) arg;
+    char        tmp[sizeof( ctx->checkpoint_file ) + 4];
+    FILE        *f;
+
+    sprintf(tmp, "%s.tmp", ctx->checkpoint_file);
+    if ((f = fopen(tmp, "wb")) == NULL ||
+        fwrite(ctx->checkpoint_buf, 1, ctx->checkpoint_size, f) != ctx->checkpoint_size ||
+        fclose(f) != 0 || rename(tmp, ctx->checkpoint_file) != 0)
+        printf("Cannot write checkpoint %s\n", ctx->checkpoint_file);
+
+    atomic_store( &ctx->checkpoint_busy, 0 );
+    return NULL;
+}
+
+
+void save_checkpoint( aco_context *ctx, int done, int wait )
+/*
+      FUNCTION:       snapshot the try and start writing it
+      INPUT:          pointer to the try, whether the try is finished and
+                      whether to wait for a write still in progress
+      OUTPUT:         none
+      (SIDE)EFFECTS:  without wait, a checkpoint is skipped while the previous
+                      one is still being written; the copy is the only work
+                      done on the colony's thread
+*/
+{
+    checkpoint_header h;
+    size_t            ph, best, phases;
+    char              *b;
+
+    if ( !wait && atomic_load( &ctx->checkpoint_busy ) ) return;
+    if ( ctx->checkpoint_started ) {
+        pthread_join( ctx->checkpoint_writer, NULL );
+        ctx->checkpoint_started = 0;
+    }
+
+    ph     = sizeof( pher_t ) * 2 * ctx->n;
+    best   = sizeof( uint64_t ) * ctx->n_words;
+    phases = sizeof( ctx->phases );
+    if ( !ctx->checkpoint_buf &&
+         (ctx->checkpoint_buf = (char*) malloc(sizeof( h ) + ph + best + phases)) == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+
+    memset( &h, 0, sizeof( h ) );
+    memcpy( h.magic, CKPT_MAGIC, sizeof( CKPT_MAGIC ) );
+    h.version        = CKPT_VERSION;
+    h.done           = done;
+    h.n              = ctx->n;
+    h.n_ants         = ctx->n_ants;
+    h.ntry           = ctx->ntry;
+    h.island         = ctx->island;
+    h.iteration      = ctx->iteration;
+    h.best_iteration = ctx->best_iteration;
+    h.restart_best   = ctx->restart_best;
+    h.n_restarts     = ctx->n_restarts;
+    h.u_gb           = ctx->u_gb;
+    h.pher_size      = sizeof( pher_t );
+    h.pher_unit      = ctx->pher_unit;
+    h.migrant_pending = ctx->migrant_pending;
+    h.pinned         = ctx->pinned;
+    h.branching      = ctx->branching;
+    h.trail_0        = ctx->trail_0;
+    h.trail_min      = ctx->trail_min;
+    h.trail_max      = ctx->trail_max;
+    h.best_score     = ctx->best_so_far_ant_score;
+    h.best_time      = ctx->best_time;
+    h.restart_time   = ctx->restart_time;
+    h.elapsed        = elapsed_time( ctx, REAL );
+
+    b = ctx->checkpoint_buf;
+    memcpy( b, &h, sizeof( h ) );
+    ctx->checkpoint_size = sizeof( h );
+    if ( !done ) {
+        b += sizeof( h );
+        memcpy( b, ctx->pheromone, ph );                  b += ph;
+        memcpy( b, ctx->best_so_far_ant_solution, best ); b += best;
+        memcpy( b, ctx->phases, phases );
+        ctx->checkpoint_size += ph + best + phases;
+    }
+    ctx->last_checkpoint = h.elapsed;
+
+    atomic_store( &ctx->checkpoint_busy, 1 );
+    if ( pthread_create( &ctx->checkpoint_writer, NULL, checkpoint_writer, ctx ) ) {
+        printf("Cannot start the checkpoint writer, exit.");
+        exit(1);
+    }
+    ctx->checkpoint_started = 1;
+}
+
+
+int load_checkpoint( aco_context *ctx )
+/*
+      FUNCTION:       restore the try from its checkpoint
+      INPUT:          pointer to the try, after init_aco()
+      OUTPUT:         CKPT_RESUMED, CKPT_DONE if the try had already finished
+                      or CKPT_NONE if there is no checkpoint for it
+      (SIDE)EFFECTS:  the run continues at the iteration following the
+                      checkpoint, with the same trails (and random streams,
+                      which only depend on the iteration);
+                      elapsed time includes the time before the checkpoint
+*/
+{
+    checkpoint_header h;
+    FILE              *f;
+
+    if ((f = fopen(ctx->checkpoint_file, "rb")) == NULL) return CKPT_NONE;
+    if (fread(&h, sizeof( h ), 1, f) != 1 || memcmp(h.magic, CKPT_MAGIC, sizeof( CKPT_MAGIC )) ||
+        h.version != CKPT_VERSION || h.n != ctx->n || h.n_ants != ctx->n_ants ||
+        h.ntry != ctx->ntry || h.island != ctx->island || h.pher_size != sizeof( pher_t )) {
+        printf("Checkpoint %s does not match this run, ignored\n", ctx->checkpoint_file);
+        fclose(f);
+        return CKPT_NONE;
+    }
+    if (h.done) {
+        fclose(f);
+        return CKPT_DONE;
+    }
+    if (fread(ctx->pheromone, sizeof( pher_t ), 2 * ctx->n, f) != (size_t) 2 * ctx->n ||
+        fread(ctx->best_so_far_ant_solution, sizeof( uint64_t ), ctx->n_words, f) != (size_t) ctx->n_words ||
+        fread(ctx->phases, sizeof( ctx->phases ), 1, f) != 1) {
+        printf("Truncated checkpoint %s, exit.", ctx->checkpoint_file);
+        exit(1);
+    }
+    fclose(f);
+
+    ctx->iteration             = h.iteration;
+    ctx->best_iteration        = h.best_iteration;
+    ctx->restart_best          = h.restart_best;
+    ctx->n_restarts            = h.n_restarts;
+    ctx->u_gb                  = h.u_gb;
+    ctx->trail_0               = h.trail_0;
+    ctx->trail_min             = h.trail_min;
+    ctx->trail_max             = h.trail_max;
+    ctx->pher_unit             = h.pher_unit;
+    ctx->migrant_pending       = h.migrant_pending;
+    ctx->pinned                = h.pinned;
+    ctx->branching             = h.branching;
+    ctx->best_so_far_ant_score = h.best_score;
+    ctx->best_time             = h.best_time;
+    ctx->restart_time          = h.restart_time;
+    ctx->start_real_time      -= h.elapsed;
+    ctx->last_checkpoint       = h.elapsed;
+    compute_choice_table( ctx );
+    return CKPT_RESUMED;
+}
+
+
+void exit_checkpoint( aco_context *ctx )
+/*
+      FUNCTION:       wait for the last checkpoint of the try
+      INPUT:          pointer to the try
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the snapshot buffer is released
+*/
+{
+    if ( ctx->checkpoint_started ) {
+        pthread_join( ctx->checkpoint_writer, NULL );
+        ctx->checkpoint_started = 0;
+    }
+    free( ctx->checkpoint_buf );
+    ctx->checkpoint_buf = NULL;
+}
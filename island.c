@@ -0,0 +1,132 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file island.c
+ * @brief File contains the island model: several colonies per try that
+ *        exchange their best solution through a shared migration area
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include "aco.h"
+
+
+void init_migration( migration_area *m, int n_words )
+/*
+      FUNCTION:       prepare the migration area of a try
+      INPUT:          pointer to the area and words per packed solution
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the area holds no solution yet
+*/
+{
+    pthread_mutex_init( &m->lock, NULL );
+    atomic_init( &m->done, 0 );
+    m->best_score  = INFTY;
+    m->best_island = -1;
+    if((m->best_solution = (uint64_t*) calloc(n_words, sizeof( uint64_t ))) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+}
+
+
+void exit_migration( migration_area *m )
+/*
+      FUNCTION:       release the migration area of a try
+      INPUT:          pointer to the area
+      OUTPUT:         none
+      (SIDE)EFFECTS:  none
+*/
+{
+    pthread_mutex_destroy( &m->lock );
+    free( m->best_solution );
+}
+
+
+void migrate( aco_context *ctx )
+/*
+      FUNCTION:       exchange the best-so-far solution with the other islands
+      INPUT:          pointer to the try (one island)
+      OUTPUT:         none
+      (SIDE)EFFECTS:  a better best-so-far is published to the area; a better
+                      migrant replaces the best-so-far ant (as found at this
+                      iteration and time, so final_report never pairs its score
+                      with an earlier improvement of the island), updates the
+                      MMAS trail limits and is deposited by the next mmas_update()
+*/
+{
+    migration_area *m = ctx->migration;
+
+    pthread_mutex_lock( &m->lock );
+
+    if ( ctx->best_so_far_ant_score < m->best_score ) {
+        copy_from_to( ctx, ctx->best_so_far_ant_solution, ctx->best_so_far_ant_score,
+                      m->best_solution, &m->best_score );
+        m->best_island = ctx->island;
+    }
+    else if ( m->best_score < ctx->best_so_far_ant_score ) {
+        copy_from_to( ctx, m->best_solution, m->best_score,
+                      ctx->best_so_far_ant_solution, &ctx->best_so_far_ant_score );
+        ctx->migrant_pending = 1;
+        ctx->restart_best = ctx->iteration;
+        ctx->best_iteration = ctx->iteration;
+        ctx->time_used = elapsed_time( ctx, REAL );
+        ctx->best_time = ctx->time_used;
+
+        ctx->trail_max = 1. / ( (ctx->rho) * ctx->best_so_far_ant_score );
+        ctx->trail_min = ctx->trail_max / ( 2. * ctx->n );
+        ctx->trail_0 = ctx->trail_max;
+    }
+
+    if ( m->best_score <= ctx->optimal ) atomic_store( &m->done, 1 );
+
+    pthread_mutex_unlock( &m->lock );
+}
+
+
+void run_islands( const aco_params *p, const aco_instance *inst, aco_reports *reports )
+/*
+      FUNCTION:       run every try with n_islands cooperating colonies
+      INPUT:          parameters, instance and output files
+      OUTPUT:         none
+      (SIDE)EFFECTS:  each island of a try runs aco_algorithm() on its own thread
+                      (its colony loops stay sequential) and migrates every
+                      migration_interval iterations
+*/
+{
+    int            ntry, i;
+    aco_context    *islands;
+    aco_arena      *arenas;
+    migration_area area;
+
+    if((islands = (aco_context*) aligned_alloc(CACHE_LINE, sizeof( aco_context ) * p->n_islands)) == NULL ||
+       (arenas = (aco_arena*) malloc(sizeof( aco_arena ) * p->n_islands)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < p->n_islands ; i++ )
+        init_arena( &arenas[i], p->huge_pages );
+
+    for ( ntry = 0 ; ntry < p->max_tries ; ntry++ ) {
+        printf("try %d\n",ntry);
+        init_migration( &area, inst->n_words );
+
+        #pragma omp parallel for num_threads(p->n_islands) schedule(static, 1)
+        for ( i = 0 ; i < p->n_islands ; i++ ) {
+            init_context( &islands[i], p, inst, reports, &arenas[i], ntry );
+            islands[i].island    = i;
+            islands[i].migration = &area;
+            aco_algorithm( &islands[i] );
+        }
+
+        printf("try %d: best %f from island %d\n", ntry, area.best_score, area.best_island);
+        exit_migration( &area );
+    }
+
+    for ( i = 0 ; i < p->n_islands ; i++ )
+        exit_arena( &arenas[i] );
+    free( arenas );
+    free( islands );
+}
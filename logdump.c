@@ -0,0 +1,70 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file logdump.c
+ * @brief Converts a binary log (conv_log) back into the text reports
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aco.h"
+
+
+int main( int argc, char *argv[] )
+/*
+ FUNCTION:       replay a binary log through the report writer, which writes
+                 conv_report, conv_report_iter, final_report and results_report
+                 in the current directory
+ INPUT:          log file name
+ OUTPUT:         0 on success
+ */
+{
+    FILE        *log;
+    log_header  h;
+    report_slot slot, phases[N_PHASES];
+    phase_summary summaries[N_PHASES];
+    uint64_t    *solution;
+    aco_reports reports;
+    int         i, n_payload;
+
+    if (argc != 2) {
+        printf("Usage: %s <conv_log>\n", argv[0]);
+        exit(1);
+    }
+    if ((log = fopen(argv[1], "rb")) == NULL ||
+        fread(&h, sizeof( h ), 1, log) != 1 ||
+        memcmp(h.magic, LOG_MAGIC, sizeof( h.magic )) ||
+        h.version != LOG_VERSION || h.slot_size != sizeof( report_slot ) ||
+        h.n_words != N_WORDS( h.n ) || h.n_phases != N_PHASES) {
+        printf("%s is not a binary log, exit.", argv[1]);
+        exit(1);
+    }
+
+    n_payload = REC_PAYLOAD_SLOTS( h.n_words );
+    if((solution = (uint64_t*) malloc(sizeof( uint64_t ) * n_payload * REC_WORDS)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    init_report ( &reports, h.n, 0, 0 );
+
+    while (fread(&slot, sizeof( slot ), 1, log) == 1) {
+        if (slot.rec.type == REC_FINAL) {
+            if (fread(phases, sizeof( report_slot ), N_PHASES, log) != N_PHASES ||
+                fread(solution, sizeof( report_slot ), n_payload, log) != (size_t) n_payload) {
+                printf("Truncated log, exit.");
+                exit(1);
+            }
+            for (i = 0; i < N_PHASES; i++)
+                summaries[i] = phases[i].phase;
+        }
+        queue_record(&reports, &slot.rec, summaries, solution);
+    }
+
+    exit_report( &reports );
+    free( solution );
+    fclose( log );
+    return (0);
+}
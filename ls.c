@@ -0,0 +1,88 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file ls.c
+ * @brief File contains the local search: first-improvement bit-flip hill
+ *        climbing of the iteration-best ants
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "aco.h"
+
+
+static double flip_delta( aco_context *ctx, uint64_t *solution, int gate, double score )
+/*
+      FUNCTION:       change of score if a gate is flipped
+      INPUT:          pointer to the try, solution, gate and score of the solution
+      OUTPUT:         new score - score
+      (SIDE)EFFECTS:  none; without evaluate_flip the gate is flipped, the
+                      solution scored in full and the gate flipped back
+*/
+{
+    const aco_objective *obj = ctx->objective;
+    double               flipped;
+
+    if ( obj->evaluate_flip )
+        return obj->evaluate_flip( ctx->obj_state, solution, gate );
+
+    FLIP_GATE( solution, gate );
+    obj->evaluate_batch( ctx->obj_state, solution, 1, &flipped );
+    FLIP_GATE( solution, gate );
+    return flipped - score;
+}
+
+
+static double bit_flip( aco_context *ctx, int k )
+/*
+      FUNCTION:       first-improvement bit-flip hill climbing of one ant
+      INPUT:          pointer to the try and ant
+      OUTPUT:         score of the local optimum
+      (SIDE)EFFECTS:  the solution of ant k is replaced by the local optimum;
+                      gates are scanned cyclically from a random gate, every
+                      improving flip is taken at once, and the search stops
+                      after n gates in a row without improvement
+*/
+{
+    uint64_t  *s = &ctx->ant_solutions[k * ctx->n_words];
+    double    score = ctx->ant_scores[k], delta;
+    uint64_t  rnd;
+    int       g, last;
+
+    rng_fill_bits( &ctx->ant_rng[k], &rnd, 1 );
+    g = last = (int) (rnd % (uint64_t) ctx->n);
+    do {
+        delta = flip_delta( ctx, s, g, score );
+        if ( delta < 0.0 ) {
+            FLIP_GATE( s, g );
+            score += delta;
+            last = g;
+        }
+        if ( ++g == ctx->n ) g = 0;
+    } while ( g != last );
+
+    return score;
+}
+
+
+void local_search( aco_context *ctx )
+/*
+      FUNCTION:       refine the ls_ants iteration-best ants
+      INPUT:          pointer to the try, after the colony is ranked
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the ants are improved in parallel, one per thread, and
+                      the top list is ranked again with their new scores
+*/
+{
+    top_ants  t;
+    int       e, n = ctx->top.n < ctx->ls_ants ? ctx->top.n : ctx->ls_ants;
+
+    #pragma omp parallel for if ( n > 1 ) schedule(dynamic, 1)
+    for ( e = 0 ; e < n ; e++ )
+        ctx->top.score[e] = ctx->ant_scores[ctx->top.ant[e]] = bit_flip( ctx, ctx->top.ant[e] );
+
+    t.n = 0;
+    for ( e = 0 ; e < ctx->top.n ; e++ )
+        top_insert( &t, ctx->top_k, ctx->top.ant[e], ctx->top.score[e] );
+    ctx->top = t;
+}
@@ -0,0 +1,109 @@
+#!/bin/bash
+# Golden-run regression suite: runs aco with a fixed seed on the benchmarks/
+# instances, checks that the best-score trajectory of every try matches the
+# stored golden one for every thread count, and writes the iterations per
+# second of each run, compared with a stored baseline.
+#
+#   ./perftest.sh [golden]
+#
+# With golden, perftest_golden.tsv is rewritten from the runs of the first
+# thread count instead (the other counts must still agree with it); do this
+# only for a change meant to alter the trajectories. The trajectories also
+# depend on the build flags (PHER_FLAGS, ARCH_FLAGS), the golden file is for
+# the default ones. `make perftest-baseline` stores the last perftest.tsv as
+# the throughput baseline.
+#
+# The runs are set through the environment (defaults in brackets):
+#   THREADS   values of n_threads             ["1 4"]
+#   ANTS      n_ants                          [50]
+#   ITERS     iterations of a try             [500]
+#   TRIES     tries per run                   [2]
+#   SEED      seed of the colony              [12345]
+#
+# Columns of perftest.tsv: instance, threads, iterations, time in seconds,
+# iterations per second and, with a baseline row, the speedup over it.
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+GOLDEN="$DIR/perftest_golden.tsv"
+BASELINE="$DIR/perftest_baseline.tsv"
+OUT="$DIR/perftest.tsv"
+THREADS=${THREADS:-"1 4"}
+ANTS=${ANTS:-50}
+ITERS=${ITERS:-500}
+TRIES=${TRIES:-2}
+SEED=${SEED:-12345}
+
+make -C "$DIR" aco > /dev/null || exit 1
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# optimal below any score: every try runs ITERS iterations
+cat > "$WORK/parameters.txt" <<EOF
+max_tries $TRIES
+n_ants $ANTS
+max_iters $ITERS
+max_time 1000000
+optimal -1
+seed $SEED
+EOF
+
+[ "$1" = "golden" ] && printf "instance\ttry\titeration\tbest_score\n" > "$WORK/golden.tsv"
+printf "instance\tthreads\titers\ttime_s\titers_per_s\tspeedup\n" > "$OUT"
+failed=0
+
+for bench in "$DIR"/benchmarks/*.bs; do
+    name=$(basename "$bench")
+    first=1
+    for threads in $THREADS; do
+        sed -i "/^n_threads/d" "$WORK/parameters.txt"
+        echo "n_threads $threads" >> "$WORK/parameters.txt"
+        rm -f "$WORK"/conv_report* "$WORK"/final_report "$WORK"/results_report
+        (cd "$WORK" && "$DIR/aco" "$bench" > /dev/null)
+
+        # trajectory: every improvement of the best score, per try
+        awk -v name="$name" '
+            /^\*+ Try/ { try = $3 }
+            !/^\*/     { printf "%s\t%d\t%d\t%s\n", name, try, $2, $1 }' \
+            "$WORK/conv_report_iter" > "$WORK/trajectory.tsv"
+
+        if [ "$1" = "golden" ] && [ $first = 1 ]; then
+            cat "$WORK/trajectory.tsv" >> "$WORK/golden.tsv"
+            cp "$WORK/trajectory.tsv" "$WORK/reference.tsv"
+        elif [ "$1" = "golden" ]; then
+            cmp -s "$WORK/trajectory.tsv" "$WORK/reference.tsv" ||
+                { echo "FAIL $name: $threads threads differ from ${THREADS%% *}"; failed=1; }
+        else
+            grep "^$name	" "$GOLDEN" 2>/dev/null > "$WORK/reference.tsv"
+            if ! cmp -s "$WORK/trajectory.tsv" "$WORK/reference.tsv"; then
+                echo "FAIL $name: $threads threads differ from the golden trajectory"
+                diff "$WORK/reference.tsv" "$WORK/trajectory.tsv" | head -4
+                failed=1
+            fi
+        fi
+        first=0
+
+        awk -v name="$name" -v threads="$threads" -v baseline="$BASELINE" '
+            BEGIN {
+                while ((getline line < baseline) > 0) {
+                    split(line, f, "\t")
+                    if (f[1] == name && f[2] == threads) base = f[5]
+                }
+            }
+            /^ Try/ {
+                for (i = 1; i < NF; i++) {
+                    if ($i == "iters") iters += $(i + 1)
+                    else if ($i == "time") time += $(i + 1)
+                }
+            }
+            END {
+                ips = time > 0 ? iters / time : 0
+                speedup = base > 0 ? sprintf("%.3f", ips / base) : "NA"
+                printf "%s\t%d\t%d\t%f\t%.1f\t%s\n", name, threads, iters, time, ips, speedup
+            }' "$WORK/final_report" | tee -a "$OUT"
+    done
+done
+
+[ "$1" = "golden" ] && [ $failed = 0 ] && cp "$WORK/golden.tsv" "$GOLDEN"
+[ $failed = 0 ] && echo "trajectories match" || echo "trajectories differ"
+exit $failed
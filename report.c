@@ -0,0 +1,319 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file report.c
+ * @brief File contains the report writer: the tries queue fixed-size records
+ *        in a lock-free ring and a background thread does all the file I/O
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include "aco.h"
+
+static const char *phase_names[N_PHASES] =
+    { "construct", "evaluate", "local", "statistics", "migrate", "pheromone" };
+
+
+static int drain_ring( aco_reports *r )
+/*
+      FUNCTION:       write every record published so far
+      INPUT:          pointer to the reports
+      OUTPUT:         number of slots written
+      (SIDE)EFFECTS:  the slots are handed back to the producers
+*/
+{
+    report_slot *slot;
+    size_t      pos;
+    int         i, k, written = 0;
+
+    for ( ; ; ) {
+        pos = r->head;
+        if ( atomic_load_explicit( &r->seq[pos & r->mask], memory_order_acquire ) != pos + 1 )
+            break;
+        slot = &r->slots[pos & r->mask];
+        k = (slot->rec.type == REC_FINAL) ? REC_FINAL_SLOTS( r->n_words ) : 1;
+
+        for ( i = 0 ; i < k ; i++ ) {
+            /* the producer claimed all k slots at once, wait for it to publish them */
+            while ( atomic_load_explicit( &r->seq[(pos + i) & r->mask], memory_order_acquire ) != pos + i + 1 )
+                sched_yield();
+            if ( r->log )
+                fwrite( &r->slots[(pos + i) & r->mask], sizeof( report_slot ), 1, r->log );
+            else if ( i > N_PHASES )
+                memcpy( &r->solution[(i - 1 - N_PHASES) * REC_WORDS], r->slots[(pos + i) & r->mask].words,
+                        sizeof( uint64_t ) * REC_WORDS );
+            else if ( i > 0 )
+                r->phases[i - 1] = r->slots[(pos + i) & r->mask].phase;
+        }
+        if ( !r->log )
+            print_record( r, &slot->rec, r->phases, r->solution );
+
+        for ( i = 0 ; i < k ; i++ )
+            atomic_store_explicit( &r->seq[(pos + i) & r->mask], pos + i + r->mask + 1, memory_order_release );
+        r->head = pos + k;
+        written += k;
+    }
+    return written;
+}
+
+
+static void *report_writer( void *arg )
+/*
+      FUNCTION:       body of the writer thread
+      INPUT:          pointer to the reports
+      OUTPUT:         none
+      (SIDE)EFFECTS:  polls the ring until exit_report() stops it; files are
+                      flushed after every batch so they follow the run
+*/
+{
+    aco_reports     *r = (aco_reports *) arg;
+    struct timespec idle = { 0, 500000 };
+    int             stop;
+
+    for ( ; ; ) {
+        stop = atomic_load_explicit( &r->stop, memory_order_acquire );
+        if ( drain_ring( r ) ) {
+            if ( r->log ) fflush( r->log );
+            if ( r->report ) fflush( r->report );
+            if ( r->report_iter ) fflush( r->report_iter );
+            if ( r->final_report ) fflush( r->final_report );
+            if ( r->results_report ) fflush( r->results_report );
+            if ( r->stagnation ) fflush( r->stagnation );
+        }
+        else if ( stop )
+            break;
+        else
+            nanosleep( &idle, NULL );
+    }
+    return NULL;
+}
+
+
+void init_report( aco_reports *r, int n, int binary, int append )
+/*
+      FUNCTION:       open the report files and start the writer thread
+      INPUT:          pointer to the reports, problem size, whether to write
+                      the binary log (conv_log) instead of the text reports and
+                      whether to append to the files of a run being resumed
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the ring holds at least two REC_FINAL records
+*/
+{
+    log_header h;
+    size_t     i, size = REPORT_RING_SLOTS;
+
+    memset( r, 0, sizeof( aco_reports ) );
+    r->n       = n;
+    r->n_words = N_WORDS( n );
+    r->append  = append;
+
+    if ( binary ) {
+        memset( &h, 0, sizeof( h ) );
+        memcpy( h.magic, LOG_MAGIC, sizeof( h.magic ) );
+        h.version   = LOG_VERSION;
+        h.slot_size = sizeof( report_slot );
+        h.n         = n;
+        h.n_words   = r->n_words;
+        h.n_phases  = N_PHASES;
+        if ((r->log = fopen("conv_log", append ? "ab" : "wb")) == NULL ||
+            fseek(r->log, 0, SEEK_END) != 0 ||
+            (ftell(r->log) == 0 && fwrite(&h, sizeof( h ), 1, r->log) != 1)){
+            printf("Cannot write conv_log, exit.");
+            exit(1);
+        }
+    }
+    else {
+        r->report = fopen("conv_report", append ? "a" : "w");
+        r->report_iter = fopen("conv_report_iter", append ? "a" : "w");
+        r->results_report = fopen("results_report", append ? "a" : "w");
+        r->final_report = fopen("final_report", append ? "a" : "w");
+    }
+
+    while ( size < 2 * REC_FINAL_SLOTS( r->n_words ) )
+        size <<= 1;
+    r->mask = size - 1;
+    if((r->slots = (report_slot*) aligned_alloc(CACHE_LINE, sizeof( report_slot ) * size)) == NULL ||
+       (r->seq = (_Atomic size_t*) malloc(sizeof( _Atomic size_t ) * size)) == NULL ||
+       (r->solution = (uint64_t*) calloc(REC_PAYLOAD_SLOTS( r->n_words ) * REC_WORDS, sizeof( uint64_t ))) == NULL ||
+       (r->line = (char*) malloc(2 * n + 1)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < size ; i++ )
+        atomic_init( &r->seq[i], i );
+    atomic_init( &r->tail, 0 );
+    atomic_init( &r->stalls, 0 );
+    atomic_init( &r->stop, 0 );
+
+    if ( pthread_create( &r->writer, NULL, report_writer, r ) ) {
+        printf("Cannot start the report writer, exit.");
+        exit(1);
+    }
+}
+
+
+void exit_report( aco_reports *r )
+/*
+      FUNCTION:       write the pending records and close the report files
+      INPUT:          pointer to the reports
+      OUTPUT:         none
+      (SIDE)EFFECTS:  joins the writer thread
+*/
+{
+    long stalls;
+
+    atomic_store_explicit( &r->stop, 1, memory_order_release );
+    pthread_join( r->writer, NULL );
+
+    if ( (stalls = atomic_load( &r->stalls )) > 0 )
+        printf("report ring was full %ld times\n", stalls);
+
+    if ( r->log ) fclose( r->log );
+    if ( r->report ) fclose( r->report );
+    if ( r->report_iter ) fclose( r->report_iter );
+    if ( r->final_report ) fclose( r->final_report );
+    if ( r->results_report ) fclose( r->results_report );
+    if ( r->stagnation ) fclose( r->stagnation );
+    free( r->slots );
+    free( (void *) r->seq );
+    free( r->solution );
+    free( r->line );
+}
+
+
+void queue_record( aco_reports *r, const report_record *rec, const phase_summary *phases,
+                   const uint64_t *solution )
+/*
+      FUNCTION:       hand a record to the writer thread
+      INPUT:          pointer to the reports, the record and, for REC_FINAL,
+                      the phase timers (N_PHASES) and the packed solution (n_words words)
+      OUTPUT:         none
+      (SIDE)EFFECTS:  lock-free; only waits if the ring is full, and counts
+                      it in stalls
+*/
+{
+    size_t pos, last, seq;
+    int    i, k, w, j;
+
+    k = (rec->type == REC_FINAL) ? REC_FINAL_SLOTS( r->n_words ) : 1;
+
+    /* claim k consecutive slots; the writer frees slots in order, so the last
+       one being free means the whole run is */
+    pos = atomic_load_explicit( &r->tail, memory_order_relaxed );
+    for ( ; ; ) {
+        last = pos + k - 1;
+        seq  = atomic_load_explicit( &r->seq[last & r->mask], memory_order_acquire );
+        if ( seq == last ) {
+            if ( atomic_compare_exchange_weak_explicit( &r->tail, &pos, pos + k,
+                                                        memory_order_relaxed, memory_order_relaxed ) )
+                break;
+        }
+        else if ( (ptrdiff_t) (seq - last) < 0 ) {
+            atomic_fetch_add_explicit( &r->stalls, 1, memory_order_relaxed );
+            sched_yield();
+            pos = atomic_load_explicit( &r->tail, memory_order_relaxed );
+        }
+        else
+            pos = atomic_load_explicit( &r->tail, memory_order_relaxed );
+    }
+
+    r->slots[pos & r->mask].rec = *rec;
+    for ( i = 1 ; i < k && i <= N_PHASES ; i++ )
+        r->slots[(pos + i) & r->mask].phase = phases[i - 1];
+    for ( ; i < k ; i++ )
+        for ( w = 0 ; w < REC_WORDS ; w++ ) {
+            j = (i - 1 - N_PHASES) * REC_WORDS + w;
+            r->slots[(pos + i) & r->mask].words[w] = (j < r->n_words) ? solution[j] : 0;
+        }
+
+    for ( i = 0 ; i < k ; i++ )
+        atomic_store_explicit( &r->seq[(pos + i) & r->mask], pos + i + 1, memory_order_release );
+}
+
+
+void print_record( aco_reports *r, const report_record *rec, const phase_summary *phases,
+                   const uint64_t *solution )
+/*
+      FUNCTION:       write a record in the text reports
+      INPUT:          pointer to the reports, the record, its phase timers and solution
+      OUTPUT:         none
+      (SIDE)EFFECTS:  only called from the writer thread (or the log dump tool);
+                      conv_report_stag is only created by the first REC_ITER,
+                      runs without log_stagnation do not leave an empty file
+*/
+{
+    const stagnation_record *s = (const stagnation_record *) rec;
+    int i;
+
+    switch ( rec->type ) {
+    case REC_TRY:
+        if (r->report)
+            fprintf(r->report,"******** Try: %d **********\n",rec->ntry);
+        if (r->report_iter)
+            fprintf(r->report_iter,"******** Try: %d **********\n",rec->ntry);
+        break;
+    case REC_BEST:
+        if (r->report)
+            fprintf(r->report,"%f \t %f\n",rec->score,rec->time);
+        if (r->report_iter)
+            fprintf(r->report_iter,"%f \t %d\n",rec->score,rec->iteration);
+        break;
+    case REC_FINAL:
+        if (r->final_report){
+            fprintf(r->final_report," Try %d:",rec->ntry);
+            if (rec->island >= 0) fprintf(r->final_report,"\t island %d",rec->island);
+            fprintf(r->final_report,
+                    "\t iters %d\t best_iter %d\t time %f\t best_time %f \t best_score %f\t restarts %d ",
+                    rec->iteration,rec->best_iteration,rec->time,rec->best_time,
+                    rec->score,rec->restarts);
+            if (rec->cache_hits >= 0)
+                fprintf(r->final_report,"\t cache_hits %ld\t cache_misses %ld ",
+                        (long) rec->cache_hits,(long) rec->cache_misses);
+            for (i = 0; i < N_PHASES; i++)
+                if (phases[i].count)
+                    fprintf(r->final_report,
+                            "\t %s_s %f\t %s_mean_us %.2f\t %s_p50_us %.2f\t %s_p90_us %.2f\t %s_p99_us %.2f ",
+                            phase_names[i],phases[i].total,phase_names[i],phases[i].mean,
+                            phase_names[i],phases[i].p50,phase_names[i],phases[i].p90,
+                            phase_names[i],phases[i].p99);
+            fprintf(r->final_report,"\n");
+        }
+        fprintSolution(r, rec->ntry, solution);
+        break;
+    case REC_ITER:
+        if (!r->stagnation) {
+            if ((r->stagnation = fopen("conv_report_stag", r->append ? "a" : "w")) == NULL)
+                break;
+            if (ftell(r->stagnation) == 0)
+                fprintf(r->stagnation,"try\tisland\titer\ttime\tbest_score\titer_score\tpinned\tbranching\tdiversity\n");
+        }
+        fprintf(r->stagnation,"%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\n",
+                s->ntry,s->island,s->iteration,s->time,s->best_score,s->iteration_score,
+                s->pinned,s->branching,s->diversity);
+        break;
+    }
+}
+
+
+void fprintSolution( aco_reports *r, int ntry, const uint64_t *t )
+/*
+ FUNCTION:       print the solution *t
+ INPUT:          pointer to the reports, try and a solution
+ OUTPUT:         none
+ COMMENTS:       the gates are formatted in a buffer and written at once
+ */
+{
+    int   i;
+
+    if(r->results_report) {
+    	for( i = 0 ; i < r->n ; i++ ) {
+        	r->line[2 * i]     = '0' + GET_GATE( t, i );
+        	r->line[2 * i + 1] = ' ';
+    	}
+    	r->line[2 * r->n] = '\0';
+    	fprintf(r->results_report,"Try: %d, sol=[ %s ]\n",ntry,r->line);
+    }
+}
@@ -0,0 +1,70 @@
+#!/bin/bash
+# End-to-end scaling harness: runs aco on generated instances over a grid of
+# sizes, colony sizes and thread counts and writes one table row per run.
+#
+#   ./scaling.sh [table.tsv]
+#
+# The grid is set through the environment (defaults in brackets):
+#   NS        instance sizes                  ["1000 10000 100000"]
+#   ANTS      values of n_ants                ["32 100"]
+#   THREADS   values of n_threads             ["1 2 4"]
+#   TRIES     tries per run                   [3]
+#   MAX_TIME  max_time of a try, seconds      [60]
+#   SEED      instance seed                   [1]
+#
+# Strong scaling: fixed n, growing THREADS. Weak scaling: grow n with THREADS
+# and pick the matching rows.
+#
+# Columns: n, n_ants, threads, tries, tries that reached the optimum, mean
+# time to the optimum over those tries (NA if none), mean iterations per
+# second and peak RSS of the process in kB.
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+OUT=${1:-scaling.tsv}
+NS=${NS:-"1000 10000 100000"}
+ANTS=${ANTS:-"32 100"}
+THREADS=${THREADS:-"1 2 4"}
+TRIES=${TRIES:-3}
+MAX_TIME=${MAX_TIME:-60}
+SEED=${SEED:-1}
+
+make -C "$DIR" aco bsgen > /dev/null || exit 1
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+printf "n\tn_ants\tthreads\ttries\tsolved\ttime_to_opt_s\titers_per_s\tpeak_rss_kb\n" > "$OUT"
+
+for n in $NS; do
+    "$DIR/bsgen" "$n" "$SEED" "$WORK/instance_$n.bin" || exit 1
+    for ants in $ANTS; do
+        for threads in $THREADS; do
+            cat > "$WORK/parameters.txt" <<EOF
+max_tries $TRIES
+n_ants $ants
+n_threads $threads
+max_time $MAX_TIME
+max_iters 1000000000
+optimal 0.0
+EOF
+            rss=$(cd "$WORK" && "$DIR/aco" "$WORK/instance_$n.bin" | awk '/^peak_rss_kb/ { print $2 }')
+            awk -v n="$n" -v ants="$ants" -v threads="$threads" -v rss="$rss" '
+                /^ Try/ {
+                    for (i = 1; i < NF; i++) {
+                        if ($i == "iters") iters = $(i + 1)
+                        else if ($i == "time") time = $(i + 1)
+                        else if ($i == "best_time") best_time = $(i + 1)
+                        else if ($i == "best_score") score = $(i + 1)
+                    }
+                    tries++
+                    if (time > 0) ips += iters / time
+                    if (score <= 0) { solved++; tto += best_time }
+                }
+                END {
+                    printf "%d\t%d\t%d\t%d\t%d\t%s\t%.1f\t%s\n", n, ants, threads, tries, solved,
+                           solved ? sprintf("%f", tto / solved) : "NA",
+                           tries ? ips / tries : 0, rss
+                }' "$WORK/final_report" | tee -a "$OUT"
+        done
+    done
+done
@@ -0,0 +1,255 @@
+/**
+ * Ant Colony Optimization for the CellNopt
+ *
+ * @file sweep.c
+ * @brief Parameter sweep: every combination of a grid of n_ants, rho, q_0
+ *        and restart_iters is run on several benchmarks in one process, and
+ *        the results are gathered in one table
+ *
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "aco.h"
+
+#define SWEEP_FILE        "sweep.txt"
+#define SWEEP_RESULTS     "sweep_results"
+#define MAX_SWEEP_VALUES  32     /* values of one parameter of the grid */
+
+/* the grid: parameters that can be swept and their values, the settings of
+   parameters.txt when a parameter is not listed in SWEEP_FILE */
+enum { SW_N_ANTS, SW_RHO, SW_Q_0, SW_RESTART_ITERS, N_SWEEP };
+
+static const char *sweep_names[N_SWEEP] = { "n_ants", "rho", "q_0", "restart_iters" };
+
+static double sweep_values[N_SWEEP][MAX_SWEEP_VALUES];
+static int    n_sweep_values[N_SWEEP];
+
+/* outcome of one try */
+typedef struct {
+    double score;
+    double best_time;
+    double time;
+    int    iterations;
+} sweep_run;
+
+
+static void read_sweep( const aco_params *p )
+/*
+ FUNCTION:       read the grid
+ INPUT:          pointer to the base parameter settings
+ OUTPUT:         none
+ COMMENTS:       one line per swept parameter, its name followed by its
+                 values, e.g. "rho 0.1 0.3 0.5"; unknown names are reported
+                 and skipped like in read_parameters()
+ */
+{
+    FILE   *f;
+    char   line[LINE_BUF_LEN], *tok;
+    int    i;
+
+    n_sweep_values[SW_N_ANTS]         = 1;
+    sweep_values[SW_N_ANTS][0]        = p->n_ants;
+    n_sweep_values[SW_RHO]            = 1;
+    sweep_values[SW_RHO][0]           = p->rho;
+    n_sweep_values[SW_Q_0]            = 1;
+    sweep_values[SW_Q_0][0]           = p->q_0;
+    n_sweep_values[SW_RESTART_ITERS]  = 1;
+    sweep_values[SW_RESTART_ITERS][0] = p->restart_iters;
+
+    if ((f = fopen(SWEEP_FILE, "r")) == NULL) {
+        printf("Without %s => single configuration...\n", SWEEP_FILE);
+        return;
+    }
+    while (fgets(line, sizeof( line ), f)) {
+        if ((tok = strtok(line, " \t\n")) == NULL) continue;
+        for (i = 0; i < N_SWEEP && strcmp(tok, sweep_names[i]); i++) ;
+        if (i == N_SWEEP) {
+            printf(">>>>>>>>> Unknown sweep parameter: %s\n", tok);
+            continue;
+        }
+        n_sweep_values[i] = 0;
+        while ((tok = strtok(NULL, " \t\n")) && n_sweep_values[i] < MAX_SWEEP_VALUES)
+            sweep_values[i][n_sweep_values[i]++] = atof(tok);
+        if (n_sweep_values[i] == 0) {
+            printf("No values for sweep parameter %s, exit.", sweep_names[i]);
+            exit(1);
+        }
+    }
+    fclose(f);
+}
+
+
+static void set_configuration( aco_params *p, int c )
+/*
+ FUNCTION:       parameter settings of configuration c of the grid
+ INPUT:          pointer to the parameter settings, with the base settings,
+                 and configuration index; restart_iters varies fastest
+ OUTPUT:         none
+ */
+{
+    int i, v;
+
+    for (i = N_SWEEP - 1; i >= 0; i--) {
+        v = c % n_sweep_values[i];
+        c /= n_sweep_values[i];
+        switch (i) {
+        case SW_N_ANTS:        p->n_ants = (int) sweep_values[i][v]; break;
+        case SW_RHO:           p->rho = sweep_values[i][v]; break;
+        case SW_Q_0:           p->q_0 = sweep_values[i][v]; break;
+        case SW_RESTART_ITERS: p->restart_iters = (int) sweep_values[i][v]; break;
+        }
+    }
+}
+
+
+static void write_results( const char *name, char **bench_files, int n_inst, int n_conf,
+                           const aco_params *base, const sweep_run *runs )
+/*
+ FUNCTION:       write the results table
+ INPUT:          file name, benchmark names, number of benchmarks and of
+                 configurations, base parameter settings and the tries, in
+                 job order
+ OUTPUT:         none
+ COMMENTS:       one row per benchmark and configuration; the time to the
+                 best score and the iterations per second are averaged
+                 over the tries, solved counts the tries that reached optimal
+ */
+{
+    FILE             *f;
+    aco_params       p;
+    const sweep_run  *r;
+    int              i, c, t, solved, iterations;
+    double           best, sum, best_time, time;
+
+    if ((f = fopen(name, "w")) == NULL) {
+        printf("Cannot write %s, exit.", name);
+        exit(1);
+    }
+    fprintf(f, "instance\tn_ants\trho\tq_0\trestart_iters\ttries\tsolved\tbest_score\tmean_score"
+               "\tmean_best_time_s\titers_per_s\n");
+
+    for (i = 0; i < n_inst; i++)
+        for (c = 0; c < n_conf; c++) {
+            p = *base;
+            set_configuration( &p, c );
+            r = &runs[(i * n_conf + c) * base->max_tries];
+            solved = iterations = 0;
+            best = INFTY;
+            sum = best_time = time = 0.0;
+            for (t = 0; t < base->max_tries; t++) {
+                if (r[t].score <= base->optimal) solved++;
+                if (r[t].score < best) best = r[t].score;
+                sum        += r[t].score;
+                best_time  += r[t].best_time;
+                time       += r[t].time;
+                iterations += r[t].iterations;
+            }
+            fprintf(f, "%s\t%d\t%f\t%f\t%d\t%d\t%d\t%f\t%f\t%f\t%f\n", bench_files[i],
+                    p.n_ants, p.rho, p.q_0, p.restart_iters, base->max_tries, solved, best,
+                    sum / base->max_tries, best_time / base->max_tries,
+                    time > 0.0 ? iterations / time : 0.0);
+        }
+    fclose(f);
+}
+
+
+int main( int argc, char *argv[] )
+/*
+ FUNCTION:       run the sweep
+ INPUT:          benchmark files; the base settings are read from
+                 parameters.txt and the grid from SWEEP_FILE
+ OUTPUT:         0
+ COMMENTS:       every try of every configuration and benchmark is a job of
+                 one pool of n_threads threads; a job runs its colony on its
+                 own thread, like parallel_tries. The benchmarks are read
+                 once and shared read-only by the jobs, and all
+                 configurations use the same seed. Tries write no reports,
+                 checkpoints or islands
+ */
+{
+    aco_params   params;
+    aco_instance *instances;
+    aco_context  *contexts;
+    aco_arena    *arenas;
+    sweep_run    *runs;
+    int          n_inst = argc - 1, n_conf = 1, n_jobs, n_pool = 1, i, j;
+
+    if (n_inst < 1) {
+        printf("Usage: %s <benchmark>...\n", argv[0]);
+        exit(1);
+    }
+
+    set_default_parameters( &params );
+    read_parameters( &params );
+    params.n_islands           = 1;
+    params.checkpoint_interval = -1.0;
+    params.resume              = 0;
+    print_parameters( &params );
+    init_threads( &params );
+
+    read_sweep( &params );
+    for (i = 0; i < N_SWEEP; i++) n_conf *= n_sweep_values[i];
+    n_jobs = n_inst * n_conf * params.max_tries;
+#ifdef _OPENMP
+    n_pool = omp_get_max_threads();
+#endif
+    printf("sweep\t\t\t %d instances x %d configurations x %d tries on %d threads\n",
+           n_inst, n_conf, params.max_tries, n_pool);
+
+    if((instances = (aco_instance*) malloc(sizeof( aco_instance ) * n_inst)) == NULL ||
+       (contexts = (aco_context*) aligned_alloc(CACHE_LINE, sizeof( aco_context ) * n_pool)) == NULL ||
+       (arenas = (aco_arena*) malloc(sizeof( aco_arena ) * n_pool)) == NULL ||
+       (runs = (sweep_run*) malloc(sizeof( sweep_run ) * n_jobs)) == NULL){
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for (i = 0; i < n_pool; i++)
+        init_arena( &arenas[i], params.huge_pages );
+    for (i = 0; i < n_inst; i++) {
+        read_benchmark( argv[i + 1], &instances[i] );
+        instances[i].objective = &toymodel_objective;
+        instances[i].obj_state = instances[i].objective->init( &instances[i] );
+    }
+
+    /* job j: benchmark, then configuration, then try */
+    #pragma omp parallel for num_threads(n_pool) schedule(dynamic, 1)
+    for (j = 0; j < n_jobs; j++) {
+        aco_context *ctx;
+        aco_params  p = params;
+        int         t = 0;
+
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        ctx = &contexts[t];
+        set_configuration( &p, (j / params.max_tries) % n_conf );
+        init_context( ctx, &p, &instances[j / (params.max_tries * n_conf)], NULL,
+                      &arenas[t], j % params.max_tries );
+        runs[j].score      = aco_algorithm( ctx );
+        runs[j].time       = elapsed_time( ctx, REAL );
+        runs[j].best_time  = ctx->best_time;
+        runs[j].iterations = ctx->iteration - 1;
+    }
+
+    write_results( SWEEP_RESULTS, &argv[1], n_inst, n_conf, &params, runs );
+
+    for (i = 0; i < n_inst; i++) {
+        instances[i].objective->teardown( instances[i].obj_state );
+        exit_benchmark( &instances[i] );
+    }
+    for (i = 0; i < n_pool; i++)
+        exit_arena( &arenas[i] );
+    free( instances );
+    free( arenas );
+    free( contexts );
+    free( runs );
+    print_resource_usage();
+    return (0);
+}
@@ -12,26 +12,121 @@
 #include <assert.h>
 #include <limits.h>
 #include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "aco.h"
 
-int *bs_optimum;  /* problem optimal solution (for toy model) */
 
-double obj_function ( int k )
+static void * toymodel_init ( const aco_instance *inst )
+/*    
+      FUNCTION:       set up the toy model for an instance
+      INPUT:          problem instance
+      OUTPUT:         objective state: the instance itself, which holds the optimum
+*/
+{
+    return ((void *) inst);
+}
+
+
+double obj_function ( void *state, const uint64_t *solution )
 /*    
       FUNCTION:       cost function that computes the distance to the known optimum
-      INPUT:          optimum and ant-solution
+      INPUT:          objective state (optimum) and ant-solution
       OUTPUT:         score
-
+      COMMENTS:       Hamming distance, computed word-wise as popcount of the XOR
 */
 {
+    const aco_instance *inst = (const aco_instance *) state;
     int     i, sc = 0;
   
-    for ( i = 0 ; i < n ; i++ ) {
-        if (bs_optimum[i] != ant_solutions[k * n + i]) sc++;
+    for ( i = 0 ; i < inst->n_words ; i++ ) {
+        sc += __builtin_popcountll( inst->bs_optimum[i] ^ solution[i] );
     }
 
    return ((double) sc);
 }
 
 
+static void toymodel_evaluate_batch ( void *state, const uint64_t *solutions, int n_ants,
+                                      double *scores )
+/*    
+      FUNCTION:       cost function for a whole colony
+      INPUT:          objective state, the colony solutions (n_ants packed solutions
+                      one after the other) and the number of ants
+      OUTPUT:         none
+      (SIDE)EFFECTS:  scores[k] is the score of ant k; ants are scored in parallel,
+                      or, with fewer ants than threads, the words of each ant
+*/
+{
+    const aco_instance *inst = (const aco_instance *) state;
+    int     k;
+
+#ifdef _OPENMP
+    if ( n_ants < omp_get_max_threads() && !omp_in_parallel() ) {
+        for ( k = 0 ; k < n_ants ; k++ ) {
+            const uint64_t *solution = &solutions[k * inst->n_words];
+            int            i, sc = 0;
+
+            #pragma omp parallel for schedule(static) reduction(+:sc)
+            for ( i = 0 ; i < inst->n_words ; i++ )
+                sc += __builtin_popcountll( inst->bs_optimum[i] ^ solution[i] );
+            scores[k] = (double) sc;
+        }
+        return;
+    }
+#endif
+
+    #pragma omp parallel for schedule(static)
+    for ( k = 0 ; k < n_ants ; k++ ) {
+        scores[k] = obj_function( state, &solutions[k * inst->n_words] );
+    }
+}
+
+
+static double toymodel_evaluate_word ( void *state, int w, uint64_t word )
+/*    
+      FUNCTION:       part of the cost function due to one word of gates
+      INPUT:          objective state, index w of the word and its packed gates
+      OUTPUT:         number of gates of the word that differ from the optimum
+      COMMENTS:       summed over all words it gives obj_function()
+*/
+{
+    const aco_instance *inst = (const aco_instance *) state;
+
+    return ((double) __builtin_popcountll( inst->bs_optimum[w] ^ word ));
+}
+
+
+static double toymodel_evaluate_flip ( void *state, const uint64_t *solution, int gate )
+/*    
+      FUNCTION:       change of the cost function if one gate is flipped
+      INPUT:          objective state, ant-solution and gate
+      OUTPUT:         -1 if the gate differs from the optimum, +1 otherwise
+*/
+{
+    const aco_instance *inst = (const aco_instance *) state;
+
+    return (GET_GATE( inst->bs_optimum, gate ) != GET_GATE( solution, gate )) ? -1.0 : 1.0;
+}
+
+
+static void toymodel_teardown ( void *state )
+/*    
+      FUNCTION:       release the toy model
+      INPUT:          objective state
+      OUTPUT:         none
+      COMMENTS:       nothing to do, the optimum belongs to the instance
+*/
+{
+}
+
 
+const aco_objective toymodel_objective = {
+    "toymodel",
+    toymodel_init,
+    toymodel_evaluate_batch,
+    toymodel_evaluate_word,    /* Hamming distance: one term per gate */
+    toymodel_evaluate_flip,
+    toymodel_teardown
+};
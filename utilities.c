@@ -6,6 +6,8 @@
  * @brief File contains in-out and other misc. procedures
  */
 
+#define _GNU_SOURCE
+#include <sched.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,78 +15,53 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "aco.h"
 
-int max_tries;
-
-int iteration;         /* iteration counter */
-int best_iteration;
-int n_restarts;
-int restart_best;
-int restart_iters;
-
-int max_iters;         /* maximum number of iterations */
-long int seed;
-
-double   max_time;          /* maximal allowed run time of a try  */
-double   time_used;         /* time used until some given event */
-double   time_passed;       /* time passed until some moment*/
-double 	 best_time;
-double 	 restart_time;
-
-double optimal;           /* optimal solution or bound to find */
-
-
-/* ------------------------------------------------------------------------ */
-
-FILE *report_iter, *report, *final_report, *results_report;
-
-char name_buf[LINE_BUF_LEN];
-int  opt;
-
-
 /**************************   TIMER  ***************************************/
-static struct rusage res;
-static struct timeval tp;
-static double virtual_time, real_time;
-
-void start_timers(void)
+void start_timers( aco_context *ctx )
 /*
  FUNCTION:       virtual and real time of day are computed and stored to
  allow at later time the computation of the elapsed time
  (virtual or real)
- INPUT:          none
+ INPUT:          pointer to the try
  OUTPUT:         none
- (SIDE)EFFECTS:  virtual and real time are computed
+ (SIDE)EFFECTS:  virtual and real time are computed; real time is taken from
+ the monotonic clock, so it is not affected by changes of the system time
  */
 {
+    struct rusage res;
+
     getrusage( RUSAGE_SELF, &res );
-    virtual_time = (double) res.ru_utime.tv_sec +
+    ctx->start_virtual_time = (double) res.ru_utime.tv_sec +
     (double) res.ru_stime.tv_sec +
     (double) res.ru_utime.tv_usec / 1000000.0 +
     (double) res.ru_stime.tv_usec / 1000000.0;
     
-    gettimeofday( &tp, NULL );
-    real_time =    (double) tp.tv_sec +
-    (double) tp.tv_usec / 1000000.0;
+    ctx->start_real_time = (double) monotonic_ns() / 1e9;
 }
 
 
 
-double elapsed_time(TIMER_TYPE type)
+double elapsed_time( aco_context *ctx, TIMER_TYPE type )
 /*
  FUNCTION:       return the time used in seconds (virtual or real, depending on type)
- INPUT:          TIMER_TYPE (virtual or real time)
+ INPUT:          pointer to the try and TIMER_TYPE (virtual or real time)
  OUTPUT:         seconds since last call to start_timers (virtual or real)
  (SIDE)EFFECTS:  none
  */
 {
+    struct rusage res;
+
     if (type == REAL) {
-        gettimeofday( &tp, NULL );
-        return( (double) tp.tv_sec +
-               (double) tp.tv_usec / 1000000.0
-               - real_time );
+        return( (double) monotonic_ns() / 1e9 - ctx->start_real_time );
     }
     else {
         getrusage( RUSAGE_SELF, &res );
@@ -92,11 +69,101 @@ double elapsed_time(TIMER_TYPE type)
                (double) res.ru_stime.tv_sec +
                (double) res.ru_utime.tv_usec / 1000000.0 +
                (double) res.ru_stime.tv_usec / 1000000.0
-               - virtual_time );
+               - ctx->start_virtual_time );
     }
     
 }
 
+uint64_t monotonic_ns( void )
+/*
+ FUNCTION:       read the monotonic clock
+ INPUT:          none
+ OUTPUT:         nanoseconds since an arbitrary origin
+ (SIDE)EFFECTS:  none
+ */
+{
+    struct timespec tp;
+
+    clock_gettime( CLOCK_MONOTONIC, &tp );
+    return (uint64_t) tp.tv_sec * 1000000000ull + (uint64_t) tp.tv_nsec;
+}
+
+
+
+void phase_sample( phase_timer *t, uint64_t *start )
+/*
+ FUNCTION:       charge the time since *start to a phase
+ INPUT:          pointer to the phase timer and to the start of the phase
+ OUTPUT:         none
+ (SIDE)EFFECTS:  *start is moved to now, the start of the next phase
+ */
+{
+    uint64_t now = monotonic_ns(), d = now - *start;
+    int      e, b;
+
+    if ( d < PHASE_SUB ) b = (int) d;
+    else {
+        e = 63 - __builtin_clzll( d );
+        b = PHASE_SUB * (e - 1) + (int) ((d >> (e - 2)) & (PHASE_SUB - 1));
+    }
+    t->hist[b]++;
+    t->total_ns += d;
+    t->count++;
+    *start = now;
+}
+
+
+
+static double phase_percentile( const phase_timer *t, double q )
+/*
+ FUNCTION:       percentile of the samples of a phase
+ INPUT:          pointer to the phase timer and q in (0,1]
+ OUTPUT:         upper bound, in ns, of the bucket holding the percentile
+ (SIDE)EFFECTS:  none
+ */
+{
+    uint64_t rank = (uint64_t) ceil( q * t->count ), seen = 0;
+    int      b, e;
+
+    for ( b = 0 ; b < PHASE_BUCKETS - 1 ; b++ ) {
+        seen += t->hist[b];
+        if ( seen >= rank ) break;
+    }
+    /* lower bound of bucket b + 1 */
+    b++;
+    if ( b < PHASE_SUB ) return (double) b;
+    e = b / PHASE_SUB + 1;
+    return ldexp( (double) (PHASE_SUB + b % PHASE_SUB), e - 2 );
+}
+
+
+
+void phase_summaries( const aco_context *ctx, phase_summary *out )
+/*
+ FUNCTION:       summarize the phase timers of a try
+ INPUT:          pointer to the try and to N_PHASES summaries
+ OUTPUT:         none
+ (SIDE)EFFECTS:  phases without samples get count 0
+ */
+{
+    int i;
+    const phase_timer *t;
+
+    memset( out, 0, sizeof( phase_summary ) * N_PHASES );
+    for ( i = 0 ; i < N_PHASES ; i++ ) {
+        t = &ctx->phases[i];
+        if ( !t->count ) continue;
+        out[i].count = (int64_t) t->count;
+        out[i].total = t->total_ns / 1e9;
+        out[i].mean  = t->total_ns / 1e3 / t->count;
+        out[i].p50   = phase_percentile( t, 0.50 ) / 1e3;
+        out[i].p90   = phase_percentile( t, 0.90 ) / 1e3;
+        out[i].p99   = phase_percentile( t, 0.99 ) / 1e3;
+    }
+}
+
+
+
 /**************************   STATISTICS  ***************************************/
 
 double ran01( long *idum )
@@ -119,34 +186,116 @@ double ran01( long *idum )
 }
 
 
-/******************* GENERATE MATRIX *******************/
+#define ROTL(x,k)   (((x) << (k)) | ((x) >> (64 - (k))))
 
-double * generate_double_matrix( int n, int m)
+static uint64_t splitmix64( uint64_t *x )
 /*    
-      FUNCTION:       malloc a matrix and return pointer to it
-      INPUT:          size of matrix as n x m 
-      OUTPUT:         pointer to matrix
-      (SIDE)EFFECTS:  
+      FUNCTION:       next value of the splitmix64 sequence
+      INPUT:          pointer to the sequence state
+      OUTPUT:         64 random bits
+      (SIDE)EFFECTS:  state is advanced; only used to seed xoshiro256**
 */
 {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
 
-  double *matrix;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
-  if((matrix = (double*) malloc(sizeof(double) * n * m)) == NULL) {              // memspace for each pointer to every row
-    printf("Out of memory, exit.");
-    exit(1);
-  }
-  return matrix;
+
+void rng_seed( ant_rng_t *r, uint64_t seed, uint64_t stream )
+/*    
+      FUNCTION:       initialize a random number stream
+      INPUT:          pointer to the stream, user seed and stream number
+      OUTPUT:         none
+      (SIDE)EFFECTS:  all lanes of the stream are filled through splitmix64, so
+                      different (seed, stream) pairs give unrelated sequences
+*/
+{
+    int      i, l;
+    uint64_t x;
+
+    x = splitmix64( &seed ) ^ (stream * 0xD1B54A32D192ED03ULL);
+    for ( l = 0 ; l < RNG_LANES ; l++ ) {
+        for ( i = 0 ; i < 4 ; i++ ) {
+            r->s[i][l] = splitmix64( &x );
+        }
+    }
 }
 
 
+static inline void rng_step( ant_rng_t *r, uint64_t *out )
+/*    
+      FUNCTION:       advance all lanes of a stream by one xoshiro256** step
+      INPUT:          pointer to the stream and to RNG_LANES output words
+      OUTPUT:         none
+      (SIDE)EFFECTS:  state is advanced; lanes are independent, the loop vectorizes
+*/
+{
+    int      l;
+    uint64_t t;
+
+    for ( l = 0 ; l < RNG_LANES ; l++ ) {
+        out[l] = ROTL( r->s[1][l] * 5, 7 ) * 9;
+        t = r->s[1][l] << 17;
+        r->s[2][l] ^= r->s[0][l];
+        r->s[3][l] ^= r->s[1][l];
+        r->s[1][l] ^= r->s[2][l];
+        r->s[0][l] ^= r->s[3][l];
+        r->s[2][l] ^= t;
+        r->s[3][l] = ROTL( r->s[3][l], 45 );
+    }
+}
+
+
+void rng_fill_bits( ant_rng_t *r, uint64_t *buf, int count )
+/*    
+      FUNCTION:       fill a buffer with random bits
+      INPUT:          pointer to the stream, the buffer and its size in words
+      OUTPUT:         none
+      (SIDE)EFFECTS:  stream is advanced by ceil(count / RNG_LANES) steps
+*/
+{
+    int      i;
+    uint64_t tail[RNG_LANES];
+
+    for ( i = 0 ; i + RNG_LANES <= count ; i += RNG_LANES ) {
+        rng_step( r, &buf[i] );
+    }
+    if ( i < count ) {
+        rng_step( r, tail );
+        memcpy( &buf[i], tail, sizeof( uint64_t ) * (count - i) );
+    }
+}
+
+
+void rng_fill_01( ant_rng_t *r, double *buf, int count )
+/*    
+      FUNCTION:       fill a buffer with random numbers uniformly distributed in [0,1)
+      INPUT:          pointer to the stream, the buffer and its size
+      OUTPUT:         none
+      (SIDE)EFFECTS:  stream is advanced by ceil(count / RNG_LANES) steps
+*/
+{
+    int      i, l;
+    uint64_t bits[RNG_LANES];
+
+    for ( i = 0 ; i < count ; i += RNG_LANES ) {
+        rng_step( r, bits );
+        for ( l = 0 ; l < RNG_LANES && i + l < count ; l++ ) {
+            buf[i + l] = RNG_TO_01( bits[l] );
+        }
+    }
+}
+
 
 /**************************   IN-OUT  ***************************************/
 
-void read_parameters( void )
+void read_parameters( aco_params *p )
 /*
  FUNCTION:       read input file,
- INPUT:          none
+ INPUT:          pointer to the parameter settings
  OUTPUT:         none
  COMMENTS:
  */
@@ -160,15 +309,35 @@ void read_parameters( void )
     else {
     	while (fscanf(params, "%s %lf", texto, &numero) > 1)
       {
-        if      ( !strcmp(texto,"max_tries") ) max_tries = (int)numero;
-        else if ( !strcmp(texto,"n_ants") ) n_ants = (int)numero;
-        else if ( !strcmp(texto,"rho") ) rho = numero;
-        else if ( !strcmp(texto,"q_0") ) q_0 = numero;
-        else if ( !strcmp(texto,"max_iters") ) max_iters = (int)numero;
-        else if ( !strcmp(texto,"restart_iters") ) restart_iters = (int)numero;
-        else if ( !strcmp(texto,"max_time") ) max_time = numero;
-        else if ( !strcmp(texto,"u_gb") ) u_gb = (int)numero;
-        else if ( !strcmp(texto,"optimal") ) optimal = numero;
+        if      ( !strcmp(texto,"max_tries") ) p->max_tries = (int)numero;
+        else if ( !strcmp(texto,"n_ants") ) p->n_ants = (int)numero;
+        else if ( !strcmp(texto,"rho") ) p->rho = numero;
+        else if ( !strcmp(texto,"q_0") ) p->q_0 = numero;
+        else if ( !strcmp(texto,"max_iters") ) p->max_iters = (int)numero;
+        else if ( !strcmp(texto,"restart_iters") ) p->restart_iters = (int)numero;
+        else if ( !strcmp(texto,"max_time") ) p->max_time = numero;
+        else if ( !strcmp(texto,"u_gb") ) p->u_gb = (int)numero;
+        else if ( !strcmp(texto,"optimal") ) p->optimal = numero;
+        else if ( !strcmp(texto,"n_threads") ) p->n_threads = (int)numero;
+        else if ( !strcmp(texto,"pin_threads") ) p->pin_threads = (int)numero;
+        else if ( !strcmp(texto,"parallel_tries") ) p->parallel_tries = numero < 1 ? 1 : (int)numero;
+        else if ( !strcmp(texto,"n_islands") ) p->n_islands = (int)numero;
+        else if ( !strcmp(texto,"migration_interval") ) p->migration_interval = numero < 1 ? 1 : (int)numero;
+        else if ( !strcmp(texto,"cache_size") ) p->cache_size = (int)numero;
+        else if ( !strcmp(texto,"cache_verify") ) p->cache_verify = (int)numero;
+        else if ( !strcmp(texto,"report_binary") ) p->report_binary = (int)numero;
+        else if ( !strcmp(texto,"elite_ants") ) p->elite_ants = (int)numero;
+        else if ( !strcmp(texto,"rank_deposit") ) p->rank_deposit = (int)numero;
+        else if ( !strcmp(texto,"checkpoint_interval") ) p->checkpoint_interval = numero;
+        else if ( !strcmp(texto,"restart_pinned") ) p->restart_pinned = numero;
+        else if ( !strcmp(texto,"restart_branching") ) p->restart_branching = numero;
+        else if ( !strcmp(texto,"restart_diversity") ) p->restart_diversity = numero;
+        else if ( !strcmp(texto,"log_stagnation") ) p->log_stagnation = (int)numero;
+        else if ( !strcmp(texto,"ls_ants") ) p->ls_ants = (int)numero;
+        else if ( !strcmp(texto,"async_colony") ) p->async_colony = (int)numero;
+        else if ( !strcmp(texto,"gate_parallel") ) p->gate_parallel = (int)numero;
+        else if ( !strcmp(texto,"huge_pages") ) p->huge_pages = (int)numero;
+        else if ( !strcmp(texto,"seed") ) p->seed = (long int)numero;
         else printf(">>>>>>>>> Unknown parameter: %s\n",texto);
      	}
     
@@ -177,145 +346,306 @@ void read_parameters( void )
 
 }
 
-void init_report( void )
-/*
- FUNCTION:       prepare report file,
- INPUT:          none
- OUTPUT:         none
- COMMENTS:
- */
-{
-    char temp_buffer[LINE_BUF_LEN];
-
-    sprintf(temp_buffer,"conv_report");
-    report = fopen(temp_buffer, "w");
-    sprintf(temp_buffer,"conv_report_iter");
-    report_iter = fopen(temp_buffer, "w");
-    sprintf(temp_buffer,"results_report");
-    results_report = fopen(temp_buffer, "w");
-    sprintf(temp_buffer,"final_report");
-    final_report = fopen(temp_buffer, "w");
-
-}
-
-
-void set_default_parameters(void)
+void set_default_parameters( aco_params *p )
 /*
  FUNCTION: set default parameter settings
- INPUT:    none
+ INPUT:    pointer to the parameter settings
  OUTPUT:   none
  COMMENTS: none
  */
 {
  
-    max_tries	     = 10;
-    n_ants         = 100;    /* number of ants */
-    rho            = 0.5;
-    q_0            = 0.0;
-    max_iters      = 5000;
-    seed           = (long int) time(NULL)*(ntry+1);
-    max_time       = 12.0;
-    optimal        = 0.0;
-    u_gb	         = 20;
-    restart_iters  = 100;
+    p->max_tries      = 10;
+    p->n_ants         = 100;    /* number of ants */
+    p->rho            = 0.5;
+    p->q_0            = 0.0;
+    p->max_iters      = 5000;
+    p->seed           = (long int) time(NULL);
+    p->max_time       = 12.0;
+    p->optimal        = 0.0;
+    p->u_gb           = 20;
+    p->restart_iters  = 100;
+    p->n_threads      = 0;
+    p->pin_threads    = 0;
+    p->parallel_tries = 1;
+    p->n_islands      = 1;
+    p->migration_interval = 25;
+    p->cache_size     = 0;
+    p->cache_verify   = 1;
+    p->report_binary  = 0;
+    p->elite_ants     = 1;
+    p->rank_deposit   = 0;
+    p->checkpoint_interval = -1.0;
+    p->resume         = 0;
+    p->restart_pinned    = 0.0;
+    p->restart_branching = 0.0;
+    p->restart_diversity = 0.0;
+    p->log_stagnation    = 0;
+    p->ls_ants           = 0;
+    p->async_colony      = 0;
+    p->gate_parallel     = 0;
+    p->huge_pages        = 0;
 }
 
 
-void print_parameters()
+void print_parameters( const aco_params *p )
 /*
  FUNCTION: print parameter settings
- INPUT:    none
+ INPUT:    pointer to the parameter settings
  OUTPUT:   none
  COMMENTS: none
  */
 {
     printf("\n Parameter settings are:\n");
-    printf("max_tries\t\t %d\n", max_tries);
-    printf("max_iters\t\t %d\n", max_iters);
-    printf("max_time\t\t %.2f\n", max_time);
-    printf("seed\t\t\t %ld\n", seed);
-    printf("optimum\t\t\t %f\n", optimal);
-    printf("n_ants\t\t\t %d\n", n_ants);
-    printf("rho\t\t\t %.2f\n", rho);
-    printf("q_0\t\t\t %.2f\n", q_0);
-    printf("restart_iters\t\t %d\n", restart_iters);
-    printf("u_gb\t\t\t %d\n", u_gb);
+    printf("max_tries\t\t %d\n", p->max_tries);
+    printf("max_iters\t\t %d\n", p->max_iters);
+    printf("max_time\t\t %.2f\n", p->max_time);
+    printf("seed\t\t\t %ld\n", p->seed);
+    printf("optimum\t\t\t %f\n", p->optimal);
+    printf("n_ants\t\t\t %d\n", p->n_ants);
+    printf("rho\t\t\t %.2f\n", p->rho);
+    printf("q_0\t\t\t %.2f\n", p->q_0);
+    printf("restart_iters\t\t %d\n", p->restart_iters);
+    printf("u_gb\t\t\t %d\n", p->u_gb);
+    printf("n_threads\t\t %d\n", p->n_threads);
+    printf("pin_threads\t\t %d\n", p->pin_threads);
+    printf("parallel_tries\t\t %d\n", p->parallel_tries);
+    printf("n_islands\t\t %d\n", p->n_islands);
+    printf("migration_interval\t %d\n", p->migration_interval);
+    printf("cache_size\t\t %d\n", p->cache_size);
+    printf("cache_verify\t\t %d\n", p->cache_verify);
+    printf("report_binary\t\t %d\n", p->report_binary);
+    printf("elite_ants\t\t %d\n", p->elite_ants);
+    printf("rank_deposit\t\t %d\n", p->rank_deposit);
+    printf("checkpoint_interval\t %.2f\n", p->checkpoint_interval);
+    printf("resume\t\t\t %d\n", p->resume);
+    printf("restart_pinned\t\t %.3f\n", p->restart_pinned);
+    printf("restart_branching\t %.3f\n", p->restart_branching);
+    printf("restart_diversity\t %.3f\n", p->restart_diversity);
+    printf("log_stagnation\t\t %d\n", p->log_stagnation);
+    printf("ls_ants\t\t\t %d\n", p->ls_ants);
+    printf("async_colony\t\t %d\n", p->async_colony);
+    printf("gate_parallel\t\t %d\n", p->gate_parallel);
+    printf("huge_pages\t\t %d\n", p->huge_pages);
 }
 
 
-void fprintSolution( int *t )
+void init_threads( const aco_params *p )
 /*
- FUNCTION:       print the solution *t
- INPUT:          pointer to a solution
- OUTPUT:         none
+ FUNCTION: set up the thread team used for the colony
+ INPUT:    pointer to the parameter settings
+ OUTPUT:   none
+ COMMENTS: with pin_threads, thread i of the team is bound to the i-th
+           core of the process affinity mask
  */
 {
-    int   i;
-
-    if(results_report) {    
-    	fprintf(results_report,"Try: %d, sol=[ ",ntry);
-    	for( i = 0 ; i < n ; i++ ) {
-        	fprintf(results_report,"%d ", t[i]);
-    	}
-    	fprintf(results_report," ]\n");
+#ifdef _OPENMP
+    if ( p->n_threads > 0 ) omp_set_num_threads( p->n_threads );
+
+    if ( p->pin_threads ) {
+        cpu_set_t allowed;
+
+        sched_getaffinity( 0, sizeof( cpu_set_t ), &allowed );
+
+        #pragma omp parallel
+        {
+            int  t, cpu, count = -1;
+            cpu_set_t mask;
+
+            t = omp_get_thread_num() % CPU_COUNT( &allowed );
+            for ( cpu = 0 ; cpu < CPU_SETSIZE ; cpu++ ) {
+                if ( CPU_ISSET( cpu, &allowed ) && ++count == t ) break;
+            }
+            CPU_ZERO( &mask );
+            CPU_SET( cpu, &mask );
+            if ( sched_setaffinity( 0, sizeof( cpu_set_t ), &mask ) )
+                printf("Could not pin thread %d to core %d\n", omp_get_thread_num(), cpu);
+        }
     }
+    printf("threads\t\t\t %d\n", omp_get_max_threads());
+#else
+    if ( p->n_threads > 1 || p->parallel_tries > 1 )
+        printf("Built without OpenMP, running on one thread\n");
+#endif
 }
 
 
-void write_report( void )
+void write_report( aco_context *ctx, int type )
 /*
- FUNCTION:       write report file
- INPUT:          pointer to a solution
+ FUNCTION:       report an event of the try
+ INPUT:          pointer to the try and record type (REC_TRY, REC_BEST, REC_FINAL,
+                 REC_ITER)
  OUTPUT:         none
+ COMMENTS:       the record is only queued, the files are written by the
+                 report thread, see report.c; tries without reports (the
+                 microbenchmarks) write nothing
  */
 {
-
-  if (final_report){
-    fprintf(final_report,
-            " Try %d:\t iters %d\t best_iter %d\t time %f\t best_time %f \t best_score %f\t restarts %d \n",
-            ntry,iteration,best_iteration,elapsed_time(REAL),best_time,best_so_far_ant_score,n_restarts);
+  report_record rec;
+  report_slot   slot;
+  phase_summary phases[N_PHASES];
+
+  if (!ctx->reports) return;
+  if (type == REC_ITER) {
+    slot.stag.type            = REC_ITER;
+    slot.stag.ntry            = ctx->ntry;
+    slot.stag.island          = ctx->migration ? ctx->island : -1;
+    slot.stag.iteration       = ctx->iteration;
+    slot.stag.time            = elapsed_time( ctx, REAL );
+    slot.stag.best_score      = ctx->best_so_far_ant_score;
+    slot.stag.iteration_score = ctx->ant_scores[ctx->top.ant[0]];
+    slot.stag.pinned          = ctx->pinned;
+    slot.stag.branching       = ctx->branching;
+    slot.stag.diversity       = ctx->diversity;
+    queue_record(ctx->reports, &slot.rec, NULL, NULL);
+    return;
   }
-  fprintSolution(best_so_far_ant_solution);
-  fflush(final_report);
-  fflush(report_iter);
-  fflush(report);
-  fflush(results_report);
+  rec.type           = type;
+  rec.ntry           = ctx->ntry;
+  rec.island         = ctx->migration ? ctx->island : -1;
+  rec.iteration      = ctx->iteration;
+  rec.best_iteration = ctx->best_iteration;
+  rec.restarts       = ctx->n_restarts;
+  rec.score          = ctx->best_so_far_ant_score;
+  rec.time           = (type == REC_BEST) ? ctx->time_used : elapsed_time( ctx, REAL );
+  rec.best_time      = ctx->best_time;
+  rec.cache_hits     = ctx->cache ? ctx->cache->hits : -1;
+  rec.cache_misses   = ctx->cache ? ctx->cache->misses : -1;
+  if (type == REC_FINAL) phase_summaries(ctx, phases);
+  queue_record(ctx->reports, &rec, phases, ctx->best_so_far_ant_solution);
+
+}
+
+static void map_benchmark( char *bench_file_name, aco_instance *inst )
+/*
+ FUNCTION:       map a binary benchmark file
+ INPUT:          file name and pointer to the instance
+ OUTPUT:         none
+ COMMENTS:       the optimum is used in place, read-only, so the
+                 load time does not depend on the instance size; only the
+                 checksum pass touches the optimum
+ */
+{
+    int fd;
+    struct stat st;
+    const bench_header *h;
 
+    if ((fd = open(bench_file_name, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    	printf("Cannot open benchmark file %s, abort\n", bench_file_name);
+	    exit(1);
+    }
+    inst->map_size = (size_t) st.st_size;
+    inst->map = mmap(NULL, inst->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (inst->map == MAP_FAILED){
+    	printf("Cannot map benchmark file %s, abort\n", bench_file_name);
+	    exit(1);
+    }
+
+    h = (const bench_header *) inst->map;
+    /* the offset is checked before it is added, so that it cannot wrap */
+    if (inst->map_size < sizeof( bench_header ) || h->version != BENCH_VERSION || h->flags ||
+        h->n < 1 || h->n > MAX_GATES || h->optimum_offset % sizeof( uint64_t ) ||
+        h->optimum_offset < sizeof( bench_header ) || h->optimum_offset > inst->map_size ||
+        N_WORDS(h->n) * sizeof( uint64_t ) > inst->map_size - h->optimum_offset){
+    	printf("Corrupted benchmark file %s, abort\n", bench_file_name);
+	    exit(1);
+    }
+
+    inst->n          = (int) h->n;
+    inst->n_words    = N_WORDS( inst->n );
+    inst->bs_optimum = (uint64_t *) ((char *) inst->map + h->optimum_offset);
+
+    if (hash_solution( inst->bs_optimum, inst->n_words ) != h->checksum){
+    	printf("Checksum mismatch in benchmark file %s, abort\n", bench_file_name);
+	    exit(1);
+    }
 }
 
-void read_benchmark( char *bench_file_name )
+
+void read_benchmark( char *bench_file_name, aco_instance *inst )
 /*
  FUNCTION:       read the solution for the toy model
- INPUT:          file name
+ INPUT:          file name and pointer to the instance
  OUTPUT:         none
+ COMMENTS:       binary files (see bench_header) are mapped, anything else is
+                 parsed as text: n followed by the n gates of the optimum
  */
 {
     int num;
     FILE *sol_opt;
+    char magic[sizeof( BENCH_MAGIC ) - 1];
+
+    inst->map = NULL;
 
     if ((sol_opt = fopen(bench_file_name, "r"))==NULL){
     	printf("No instance benchmark file specified, abort\n");
 	    exit(1);
     }
+    if (fread(magic, 1, sizeof( magic ), sol_opt) == sizeof( magic ) &&
+        !memcmp(magic, BENCH_MAGIC, sizeof( magic ))) {
+      fclose(sol_opt);
+      map_benchmark(bench_file_name, inst);
+    }
     else {
       int i = 0;
-      if (fscanf(sol_opt, "%d ", &num) == 1) {
-        n = num;
-        i++;
+      rewind(sol_opt);
+      if (fscanf(sol_opt, "%d ", &num) != 1 || num < 1 || num > MAX_GATES) {
+        printf("Invalid size in benchmark file %s, abort\n", bench_file_name);
+        exit(1);
       }
+      inst->n = num;
 
-      if((bs_optimum = (int*) malloc(sizeof( int ) )) == NULL) {
+      inst->n_words = N_WORDS( inst->n );
+      if((inst->bs_optimum = (uint64_t*) calloc(inst->n_words, sizeof( uint64_t ))) == NULL) {
         printf("Out of memory, benchmark, exit.");
         exit(1);
       }
-      bs_optimum   = (int*) calloc(n, sizeof(int));
 
-      while (fscanf(sol_opt, "%d ", &num) == 1) {
-        bs_optimum[i]= num;
+      while (i < inst->n && fscanf(sol_opt, "%d ", &num) == 1) {
+        if ( num ) SET_GATE( inst->bs_optimum, i );
         i++;
       }
+      fclose(sol_opt);
     }
 
 }
 
-    
+
+void write_benchmark_binary( char *bench_file_name, const aco_instance *inst )
+/*
+ FUNCTION:       write an instance in the binary benchmark format
+ INPUT:          file name and pointer to the instance
+ OUTPUT:         none
+ */
+{
+    FILE *out;
+    bench_header h;
+
+    memset(&h, 0, sizeof( h ));
+    memcpy(h.magic, BENCH_MAGIC, sizeof( h.magic ));
+    h.version        = BENCH_VERSION;
+    h.n              = (uint64_t) inst->n;
+    h.checksum       = hash_solution( inst->bs_optimum, inst->n_words );
+    h.optimum_offset = sizeof( bench_header );
+
+    if ((out = fopen(bench_file_name, "wb")) == NULL ||
+        fwrite(&h, sizeof( h ), 1, out) != 1 ||
+        fwrite(inst->bs_optimum, sizeof( uint64_t ), inst->n_words, out) != (size_t) inst->n_words){
+    	printf("Cannot write benchmark file %s, abort\n", bench_file_name);
+	    exit(1);
+    }
+    fclose(out);
+}
+
+
+void exit_benchmark( aco_instance *inst )
+/*
+ FUNCTION:       release an instance
+ INPUT:          pointer to the instance
+ OUTPUT:         none
+ */
+{
+    if (inst->map) munmap(inst->map, inst->map_size);
+    else free(inst->bs_optimum);
+}